@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+
+# Runs dwm on a headless Xvfb and drives it with dwm_bench for every client
+# count in BENCH_CLIENTS. Prints one line per metric:
+#   bench <N> <metric> count <c> p50_us <us> p99_us <us> max_us <us>
+# followed by the system CPU load with BENCH_HIDDEN rendering clients hidden:
+#   bench <N> hidden_cpu busy_pct <percent> frames <drawn frames>
+
+set -e
+
+SCRIPT_DIR="$(realpath $(dirname $0))"
+BENCH_CLIENTS=${BENCH_CLIENTS:-"10 100 1000"}
+BENCH_DISPLAY=${BENCH_DISPLAY:-:99}
+BENCH_HIDDEN=${BENCH_HIDDEN:-20}
+
+tmp=$(mktemp -d)
+Xvfb $BENCH_DISPLAY -screen 0 1920x1080x24 -nolisten tcp > "$tmp/xvfb.log" 2>&1 &
+xvfb=$!
+trap 'kill $xvfb 2> /dev/null; rm -rf "$tmp"' EXIT
+export DISPLAY=$BENCH_DISPLAY
+
+for n in $BENCH_CLIENTS; do
+  # an empty HOME keeps dwm from running the user's startup.sh
+  HOME=$tmp "$SCRIPT_DIR/dwm" 2> "$tmp/dwm.log" &
+  dwm=$!
+  "$SCRIPT_DIR/dwm_bench" -wait
+  "$SCRIPT_DIR/dwm_bench" $n
+  # dwm dumps its statistics on SIGUSR1, all of it before handling SIGTERM
+  kill -USR1 $dwm
+  until grep -q "round trips through XSync" "$tmp/dwm.log"; do
+    sleep 0.1
+  done
+  kill -TERM $dwm
+  wait $dwm || true
+  sed -n "s/^dwm: latency drawbar /bench $n bar_redraw /p" "$tmp/dwm.log"
+done
+
+HOME=$tmp "$SCRIPT_DIR/dwm" 2> "$tmp/dwm.log" &
+dwm=$!
+"$SCRIPT_DIR/dwm_bench" -wait
+"$SCRIPT_DIR/dwm_bench" -hidden $BENCH_HIDDEN | grep hidden_cpu
+kill -TERM $dwm
+wait $dwm || true
@@ -48,6 +48,11 @@ static const dwm_layout_t layouts[] = {
 	{ "#",      tile },    /* first entry is default */
 	{ "F",      NULL },    /* no layout function means floating behavior */
 	{ "@",      monocle },
+	{ "###",    grid },
+	{ "TTT",    bstack },
+	{ "|M|",    centeredmaster },
+	{ "[@]",    spiral },
+	{ "[\\]",   dwindle },
 };
 // clang-format on
 
@@ -109,6 +114,11 @@ static Key keys[] = {
 	{ MODKEY,           XK_t,            setlayout,      {.v = &layouts[0]} },
 	{ MODKEY,           XK_b,            setlayout,      {.v = &layouts[1]} },
 	{ MODKEY,           XK_f,            setlayout,      {.v = &layouts[2]} },
+	{ MODKEY,           XK_g,            setlayout,      {.v = &layouts[3]} },
+	{ MODKEY,           XK_o,            setlayout,      {.v = &layouts[4]} },
+	{ MODKEY,           XK_i,            setlayout,      {.v = &layouts[5]} },
+	{ MODKEY,           XK_r,            setlayout,      {.v = &layouts[6]} },
+	{ MODKEY|ShiftMask, XK_r,            setlayout,      {.v = &layouts[7]} },
 	{ MODKEY,           XK_c,            togglefloating, {0} },
 	{ MODKEY,           XK_0,            view,           {.ui = ~0 } },
 	{ MODKEY|ShiftMask, XK_0,            tag,            {.ui = ~0 } },
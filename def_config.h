@@ -2,6 +2,13 @@
 
 // 1 means respect size hints in tiled resizals
 #define DWM_RESIZE_HINTS 1
+// 1: unmap clients on unselected tags and set them to IconicState, so they can
+// stop rendering, 0: move them off screen
+#define DWM_HIDE_BY_UNMAP 0
+// 1: keep clients in per-monitor container windows, so that switching tags maps
+// and unmaps a container instead of moving every client, 0: children of the root;
+// excludes DWM_HIDE_BY_UNMAP
+#define DWM_TAG_CONTAINERS 0
 
 // 0 means no systray
 #define DWM_HAS_SYSTRAY 1
@@ -11,3 +18,9 @@
 #define DWM_SYSTRAY_SPACING 2
 // 1: if pinning fails, display systray on the first monitor, 0: display systray on the last monitor
 #define DWM_SYSTRAY_PINNING_FAIL_FIRST 1
+
+// maximum number of X events drained and coalesced before dispatching
+#define DWM_EVENT_BATCH_SIZE 256
+// file descriptors and timers the main loop can watch at the same time
+#define DWM_LOOP_MAX_FDS 16
+#define DWM_LOOP_MAX_TIMERS 16
@@ -0,0 +1,368 @@
+/* Synthetic clients for `make bench`, grown out of transient.c.
+ *
+ * dwm_bench -wait blocks until the display is up and a window manager runs.
+ * dwm_bench N maps N windows one after the other and then drives dwm with
+ * XTest key presses (Mod4+2/Mod4+1 to switch tags, Mod4+n to move the focus),
+ * timing how long it takes until the windows show the expected state. Every
+ * metric is printed as one line:
+ *
+ *   bench <N> <metric> count <c> p50_us <us> p99_us <us> max_us <us>
+ *
+ * Afterwards the root window name is changed a number of times, which makes
+ * dwm redraw the bar; that cost is reported by dwm itself, see bench.sh.
+ *
+ * dwm_bench -hidden N maps N windows that keep drawing frames like a browser
+ * or video player for as long as they are mapped, switches to the empty tag 2
+ * and measures the CPU time of the whole system while they are hidden:
+ *
+ *   bench <N> hidden_cpu busy_pct <percent of all CPUs> frames <drawn frames>
+ */
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xresource.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XTest.h>
+#include <X11/keysym.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TIMEOUT_MS 30000
+#define ROUNDS 50
+#define HIDDEN_SECONDS 5
+#define FRAME_US 16667
+#define FRAME_SIZE 256
+
+typedef struct {
+  Window win;
+  int x, y, w, h;
+  int mapped, tiled, visible;
+} Client;
+
+static Display* d;
+static Window root;
+static int sw, sh;
+static XContext context;
+static Client* clients;
+static int nclients, nvisible;
+static Window focused;
+
+static void die(const char* msg) {
+  fprintf(stderr, "dwm_bench: %s\n", msg);
+  exit(1);
+}
+
+static unsigned long now_us(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int cmp_ulong(const void* a, const void* b) {
+  unsigned long x = *(const unsigned long*)a, y = *(const unsigned long*)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static void report(int n, const char* metric, unsigned long* samples, int count) {
+  if (!count)
+    return;
+  qsort(samples, count, sizeof *samples, cmp_ulong);
+  printf("bench %d %s count %d p50_us %lu p99_us %lu max_us %lu\n",
+         n,
+         metric,
+         count,
+         samples[(count - 1) * 50 / 100],
+         samples[(count - 1) * 99 / 100],
+         samples[count - 1]);
+}
+
+static void update_visible(Client* c) {
+  int visible
+    = c->mapped && c->x + c->w > 0 && c->x < sw && c->y + c->h > 0 && c->y < sh;
+
+  nvisible += visible - c->visible;
+  c->visible = visible;
+}
+
+static void handle(XEvent* e) {
+  Client* c;
+
+  if (XFindContext(d, e->xany.window, context, (XPointer*)&c))
+    return;
+  switch (e->type) {
+  case ConfigureNotify:
+    c->x = e->xconfigure.x;
+    c->y = e->xconfigure.y;
+    c->w = e->xconfigure.width;
+    c->h = e->xconfigure.height;
+    /* dwm moves new windows off screen before mapping them */
+    if (c->mapped && c->x < sw && c->x + c->w > 0)
+      c->tiled = 1;
+    update_visible(c);
+    break;
+  case MapNotify:
+    c->mapped = 1;
+    update_visible(c);
+    break;
+  case UnmapNotify:
+    c->mapped = 0;
+    update_visible(c);
+    break;
+  case FocusIn:
+    if (e->xfocus.detail != NotifyPointer && e->xfocus.detail != NotifyInferior)
+      focused = c->win;
+    break;
+  }
+}
+
+/* processes events until done() holds */
+static void pump(int (*done)(void* data), void* data) {
+  XEvent e;
+  struct pollfd pfd = {ConnectionNumber(d), POLLIN, 0};
+  unsigned long deadline = now_us() + TIMEOUT_MS * 1000UL;
+
+  while (!done(data)) {
+    if (!XPending(d)) {
+      if (now_us() > deadline)
+        die("timed out waiting for dwm");
+      poll(&pfd, 1, 100);
+      continue;
+    }
+    XNextEvent(d, &e);
+    handle(&e);
+  }
+}
+
+static int is_tiled(void* data) { return ((Client*)data)->tiled; }
+
+static int all_hidden(void* data) { return nvisible == 0; }
+
+static int all_visible(void* data) { return nvisible == nclients; }
+
+static int focus_moved(void* data) { return focused != *(Window*)data; }
+
+static int drained(void* data) { return !XPending(d); }
+
+static void press(KeySym mod, KeySym key) {
+  KeyCode m = XKeysymToKeycode(d, mod), k = XKeysymToKeycode(d, key);
+
+  XTestFakeKeyEvent(d, m, True, CurrentTime);
+  XTestFakeKeyEvent(d, k, True, CurrentTime);
+  XTestFakeKeyEvent(d, k, False, CurrentTime);
+  XTestFakeKeyEvent(d, m, False, CurrentTime);
+  XFlush(d);
+}
+
+/* busy and total jiffies of all CPUs since boot, from /proc/stat */
+static void cpu_time(unsigned long long* busy, unsigned long long* total) {
+  unsigned long long v[8];
+  FILE* f = fopen("/proc/stat", "r");
+
+  if (!f)
+    die("cannot open /proc/stat");
+  if (fscanf(f,
+             "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+             &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7])
+      != 8)
+    die("cannot parse /proc/stat");
+  fclose(f);
+  *total = 0;
+  for (int i = 0; i < 8; ++i)
+    *total += v[i];
+  *busy = *total - v[3] - v[4]; /* without idle and iowait */
+}
+
+/* Draws a frame into every window that is mapped, the way an application
+ * keeps rendering as long as it has no reason to believe it is hidden. */
+static int draw_frames(XImage* img, unsigned int frame) {
+  unsigned int* pixels = (unsigned int*)img->data;
+  int drawn = 0;
+
+  for (int i = 0; i < nclients; ++i) {
+    if (!clients[i].mapped)
+      continue;
+    for (int y = 0; y < FRAME_SIZE; ++y)
+      for (int x = 0; x < FRAME_SIZE; ++x)
+        pixels[y * FRAME_SIZE + x] = (x + frame) * 0x010203 ^ (y + i) * 0x030201;
+    XPutImage(d,
+              clients[i].win,
+              DefaultGC(d, DefaultScreen(d)),
+              img,
+              0,
+              0,
+              0,
+              0,
+              FRAME_SIZE,
+              FRAME_SIZE);
+    ++drawn;
+  }
+  XSync(d, False);
+  return drawn;
+}
+
+static void measure_hidden(int n) {
+  unsigned long long busy0, total0, busy1, total1;
+  unsigned long next;
+  unsigned int frames = 0;
+  XImage* img;
+  char* data = malloc(FRAME_SIZE * FRAME_SIZE * 4);
+
+  if (!data)
+    die("out of memory");
+  img = XCreateImage(d,
+                     DefaultVisual(d, DefaultScreen(d)),
+                     DefaultDepth(d, DefaultScreen(d)),
+                     ZPixmap,
+                     0,
+                     data,
+                     FRAME_SIZE,
+                     FRAME_SIZE,
+                     32,
+                     0);
+  if (!img)
+    die("cannot create image");
+  press(XK_Super_L, XK_2);
+  pump(all_hidden, NULL);
+  cpu_time(&busy0, &total0);
+  next = now_us();
+  for (unsigned int frame = 0; frame < HIDDEN_SECONDS * 1000000UL / FRAME_US; ++frame) {
+    frames += draw_frames(img, frame);
+    pump(drained, NULL);
+    next += FRAME_US;
+    if (next > now_us())
+      usleep(next - now_us());
+  }
+  cpu_time(&busy1, &total1);
+  printf("bench %d hidden_cpu busy_pct %.1f frames %u\n",
+         n,
+         total1 > total0 ? 100.0 * (busy1 - busy0) / (total1 - total0) : 0.0,
+         frames);
+  XDestroyImage(img); /* frees data */
+}
+
+static void open_display(void) {
+  for (int i = 0; i < TIMEOUT_MS / 100; ++i) {
+    if ((d = XOpenDisplay(NULL)))
+      return;
+    usleep(100000);
+  }
+  die("cannot open display");
+}
+
+static void wait_for_window_manager(void) {
+  Atom check = XInternAtom(d, "_NET_SUPPORTING_WM_CHECK", False), type;
+  int format;
+  unsigned long n, extra;
+  unsigned char* p;
+
+  for (int i = 0; i < TIMEOUT_MS / 100; ++i) {
+    p = NULL;
+    if (XGetWindowProperty(
+          d, root, check, 0, 1, False, XA_WINDOW, &type, &format, &n, &extra, &p)
+          == Success
+        && n) {
+      XFree(p);
+      return;
+    }
+    if (p)
+      XFree(p);
+    usleep(100000);
+  }
+  die("no window manager");
+}
+
+int main(int argc, char* argv[]) {
+  unsigned long *samples, start;
+  int n, count, ev, err, major, minor, hidden;
+  Window before;
+  char name[32];
+
+  hidden = argc == 3 && !strcmp(argv[1], "-hidden");
+  if (argc != 2 && !hidden)
+    die("usage: dwm_bench -wait | dwm_bench N | dwm_bench -hidden N");
+  open_display();
+  root = DefaultRootWindow(d);
+  sw = DisplayWidth(d, DefaultScreen(d));
+  sh = DisplayHeight(d, DefaultScreen(d));
+  wait_for_window_manager();
+  if (!strcmp(argv[1], "-wait"))
+    return 0;
+  if ((n = atoi(argv[argc - 1])) <= 0)
+    die("N must be positive");
+  if (!XTestQueryExtension(d, &ev, &err, &major, &minor))
+    die("no XTEST extension");
+  context = XUniqueContext();
+  clients = calloc(n, sizeof *clients);
+  samples = calloc(n > 2 * ROUNDS ? n : 2 * ROUNDS, sizeof *samples);
+  if (!clients || !samples)
+    die("out of memory");
+
+  /* map to tiled */
+  for (int i = 0; i < n; ++i) {
+    Client* c = &clients[i];
+    c->win = XCreateSimpleWindow(d, root, 0, 0, 400, 400, 0, 0, 0);
+    XSaveContext(d, c->win, context, (XPointer)c);
+    XSelectInput(d, c->win, StructureNotifyMask | FocusChangeMask);
+    snprintf(name, sizeof name, "bench %d", i);
+    XStoreName(d, c->win, name);
+    ++nclients;
+    start = now_us();
+    XMapWindow(d, c->win);
+    XFlush(d);
+    pump(is_tiled, c);
+    samples[i] = now_us() - start;
+  }
+  report(n, "map_to_tiled", samples, n);
+  pump(all_visible, NULL);
+  if (hidden) {
+    measure_hidden(n);
+    goto done;
+  }
+
+  /* tag switch: away to the empty tag 2 and back */
+  for (count = 0; count < 2 * ROUNDS;) {
+    start = now_us();
+    press(XK_Super_L, XK_2);
+    pump(all_hidden, NULL);
+    samples[count++] = now_us() - start;
+    start = now_us();
+    press(XK_Super_L, XK_1);
+    pump(all_visible, NULL);
+    samples[count++] = now_us() - start;
+  }
+  report(n, "tag_switch", samples, count);
+
+  /* focus change */
+  if (n > 1) {
+    for (count = 0; count < ROUNDS; ++count) {
+      before = focused;
+      start = now_us();
+      press(XK_Super_L, XK_n);
+      pump(focus_moved, &before);
+      samples[count] = now_us() - start;
+    }
+    report(n, "focus_change", samples, count);
+  }
+
+  /* bar redraws, timed by dwm */
+  for (int i = 0; i < ROUNDS; ++i) {
+    snprintf(name, sizeof name, "bench status %d", i);
+    XStoreName(d, root, name);
+    XSync(d, False);
+  }
+
+done:
+  for (int i = 0; i < n; ++i)
+    XDestroyWindow(d, clients[i].win);
+  XSync(d, False);
+  XCloseDisplay(d);
+  free(clients);
+  free(samples);
+  return 0;
+}
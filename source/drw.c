@@ -362,13 +362,48 @@ int dwm_drw_text(dwm_drw_t* dwm_drw,
   return x + (render ? w : 0);
 }
 
+int dwm_drw_measured_text(dwm_drw_t* dwm_drw,
+                          int x,
+                          int y,
+                          unsigned int w,
+                          unsigned int h,
+                          unsigned int lpad,
+                          const char* text,
+                          unsigned int len,
+                          unsigned int textw,
+                          int invert) {
+  XftDraw* d;
+  Fnt* font;
+
+  if (!dwm_drw || !dwm_drw->scheme || !dwm_drw->fonts || !textw || lpad + textw > w)
+    return dwm_drw_text(dwm_drw, x, y, w, h, lpad, text, invert);
+
+  font = dwm_drw->fonts;
+  XSetForeground(
+    dwm_drw->dpy, dwm_drw->gc, dwm_drw->scheme[invert ? DwmFgColor : DwmBgColor].pixel);
+  XFillRectangle(dwm_drw->dpy, dwm_drw->drawable, dwm_drw->gc, x, y, w, h);
+  d = XftDrawCreate(dwm_drw->dpy,
+                    dwm_drw->drawable,
+                    DefaultVisual(dwm_drw->dpy, dwm_drw->screen),
+                    DefaultColormap(dwm_drw->dpy, dwm_drw->screen));
+  XftDrawStringUtf8(d,
+                    &dwm_drw->scheme[invert ? DwmBgColor : DwmFgColor],
+                    font->xfont,
+                    x + lpad,
+                    y + (h - font->h) / 2 + font->xfont->ascent,
+                    (XftChar8*)text,
+                    len);
+  XftDrawDestroy(d);
+
+  return x + w;
+}
+
 void dwm_drw_map(
   dwm_drw_t* dwm_drw, Window win, int x, int y, unsigned int w, unsigned int h) {
   if (!dwm_drw)
     return;
 
   XCopyArea(dwm_drw->dpy, dwm_drw->drawable, win, dwm_drw->gc, x, y, w, h, x, y);
-  XSync(dwm_drw->dpy, False);
 }
 
 unsigned int dwm_drw_fontset_getwidth(dwm_drw_t* dwm_drw, const char* text) {
@@ -377,6 +412,24 @@ unsigned int dwm_drw_fontset_getwidth(dwm_drw_t* dwm_drw, const char* text) {
   return dwm_drw_text(dwm_drw, 0, 0, 0, 0, 0, text, 0);
 }
 
+unsigned int dwm_drw_primary_font_width(dwm_drw_t* dwm_drw,
+                                        const char* text,
+                                        unsigned int len) {
+  long codepoint;
+  size_t n;
+  unsigned int w = 0;
+
+  if (!dwm_drw || !dwm_drw->fonts || !text || !len)
+    return 0;
+  for (size_t i = 0; i < len; i += n) {
+    n = utf8decode(text + i, &codepoint, MIN(UTF_SIZ, len - i));
+    if (!n || !XftCharExists(dwm_drw->dpy, dwm_drw->fonts->xfont, codepoint))
+      return 0;
+  }
+  dwm_drw_font_getexts(dwm_drw->fonts, text, len, &w, NULL);
+  return w;
+}
+
 void dwm_drw_font_getexts(
   Fnt* font, const char* text, unsigned int len, unsigned int* w, unsigned int* h) {
   XGlyphInfo ext;
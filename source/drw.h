@@ -40,6 +40,10 @@ void dwm_drw_fontset_free(Fnt* set);
 unsigned int dwm_drw_fontset_getwidth(dwm_drw_t* dwm_drw, const char* text);
 void dwm_drw_font_getexts(
   Fnt* font, const char* text, unsigned int len, unsigned int* w, unsigned int* h);
+/* width of len bytes of text in the first font, 0 if it needs a fallback font */
+unsigned int dwm_drw_primary_font_width(dwm_drw_t* dwm_drw,
+                                        const char* text,
+                                        unsigned int len);
 
 /* Colorscheme abstraction */
 void dwm_drw_clr_create(dwm_drw_t* dwm_drw, XftColor* dest, const char* clrname);
@@ -69,6 +73,18 @@ int dwm_drw_text(dwm_drw_t* dwm_drw,
                  unsigned int lpad,
                  const char* text,
                  int invert);
+/* dwm_drw_text() for text measured by dwm_drw_primary_font_width() to be textw
+ * wide: draws it in one go without measuring when it fits */
+int dwm_drw_measured_text(dwm_drw_t* dwm_drw,
+                          int x,
+                          int y,
+                          unsigned int w,
+                          unsigned int h,
+                          unsigned int lpad,
+                          const char* text,
+                          unsigned int len,
+                          unsigned int textw,
+                          int invert);
 
 /* Map functions */
 void dwm_drw_map(
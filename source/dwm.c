@@ -8,7 +8,8 @@
  *
  * The event handlers of dwm are organized in an array which is accessed
  * whenever a new event has been fetched. This allows event dispatching
- * in O(1) time.
+ * in O(1) time. Events are fetched in batches and redundant ones (e.g. a burst
+ * of title changes) are collapsed before dispatching, see dwm_event.c.
  *
  * Each child of the root window is called a client, except windows which have
  * set the override_redirect flag. Clients are organized in a linked client
@@ -27,6 +28,7 @@
 #include <X11/cursorfont.h>
 #include <errno.h>
 #include <locale.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -45,8 +47,17 @@
 #include "dwm.h"
 #include "dwm_core.h"
 #include "dwm_enum.h"
+#include "dwm_event.h"
 #include "dwm_global.h"
+#include "dwm_layout.h"
+#include "dwm_loop.h"
+#include "dwm_pool.h"
+#include "dwm_stats.h"
 #include "dwm_systray.h"
+#include "dwm_title.h"
+#include "dwm_trace.h"
+#include "dwm_winmap.h"
+#include "dwm_xcb.h"
 #include "util.h"
 
 /* macros */
@@ -59,6 +70,9 @@
 #define MOUSEMASK (BUTTONMASK | PointerMotionMask)
 #define TAGMASK ((1 << LENGTH(tags)) - 1)
 #define TEXTW(X) (dwm_drw_fontset_getwidth(dwm_drw, (X)) + lrpad)
+/* root coordinates of client C relative to the window it is a child of */
+#define PARENTX(C, X) ((X) - (DWM_TAG_CONTAINERS ? (C)->mon->mx : 0))
+#define PARENTY(C, Y) ((Y) - (DWM_TAG_CONTAINERS ? (C)->mon->my : 0))
 
 #define SYSTEM_TRAY_REQUEST_DOCK 0
 
@@ -84,13 +98,19 @@ static void (*drw_x_event_handlers[LASTEvent])(XEvent*)
      [ResizeRequest] = resizerequest,
      [UnmapNotify] = unmapnotify};
 static int running = 1;
+static int replaying = 0; /* handlers are fed from a trace, see _dwm_replay() */
 static Cur* cursor[CurLast];
 static Window wmcheckwin;
+static unsigned int _dwm_dirty; /* scheduled work not bound to a monitor */
 
 /* configuration, allows nested code to access above variables */
 #include "../config.h"
 #include "../def_config.h"
 
+#if DWM_TAG_CONTAINERS && DWM_HIDE_BY_UNMAP
+#error "DWM_TAG_CONTAINERS hides clients with their container, unset DWM_HIDE_BY_UNMAP"
+#endif
+
 static unsigned int scratchtag = 1 << LENGTH(tags);
 
 /* compile-time check if all tags fit into an unsigned int bit array. */
@@ -99,8 +119,52 @@ struct NumTags {
   char limitexceeded[(LENGTH(tags) + 1) > 31 ? -1 : 1];
 };
 
+/* clients of one tag on a monitor, in no particular order */
+typedef struct {
+  dwm_client_t** clients;
+  unsigned int n, capacity;
+} dwm_tag_members_t;
+
+typedef struct {
+  unsigned int button;
+  unsigned int mask;
+} dwm_button_grab_t;
+
+/* Slot 0 holds the state of views of several tags, slot i + 1 that of tag i.
+ * The members are indexed by tag bit instead, the last one is scratchtag. */
+struct dwm_pertag_s {
+  unsigned int curtag;
+  int nmasters[LENGTH(tags) + 1];
+  float mfacts[LENGTH(tags) + 1];
+  unsigned int sellts[LENGTH(tags) + 1];
+  const dwm_layout_t* ltidxs[LENGTH(tags) + 1][2];
+  int showbars[LENGTH(tags) + 1];
+  dwm_tag_members_t members[LENGTH(tags) + 1];
+  Window containers[LENGTH(tags) + 1]; /* by tag bit, see _dwm_container() */
+};
+
 static const char _dwm_broken_client_title[] = "broken";
 
+/* latency of keys[] and buttons[] actions, including the flush they cause */
+static dwm_histogram_t _dwm_key_latency[LENGTH(keys)];
+static dwm_histogram_t _dwm_button_latency[LENGTH(buttons)];
+static dwm_histogram_t* _dwm_action_latency;
+static unsigned long _dwm_action_start_us;
+/* clients _dwm_ensure_client_visibility() hides, top down */
+static dwm_client_t** _dwm_hide_queue;
+static unsigned int _dwm_hide_capacity;
+/* grabs of the ClkClientWin buttons under every combination of the lock
+ * modifiers, see _dwm_update_num_lock_mask() */
+static dwm_button_grab_t _dwm_button_grabs[LENGTH(buttons) * 4];
+static unsigned int _dwm_button_grab_count;
+/* XRestackWindows() argument, see restack() */
+static Window* _dwm_restack_windows;
+static unsigned int _dwm_restack_capacity;
+/* input and output of the layout kernels, see _dwm_arrange_tiled() */
+static dwm_layout_client_t* _dwm_layout_input;
+static dwm_rect_t* _dwm_layout_rects;
+static unsigned int _dwm_layout_capacity;
+
 /* function implementations */
 /* static void _dwm_log(char const* str) { */
 /*   FILE* f = fopen("/tmp/dwm.log", "a+"); */
@@ -110,24 +174,212 @@ static const char _dwm_broken_client_title[] = "broken";
 /*   fclose(f); */
 /* } */
 
+/* Marks work to be done for monitor m (all monitors if m is NULL). Nothing is
+ * arranged or drawn until _dwm_flush_scheduled() runs after the event batch. */
+static void _dwm_schedule(dwm_monitor_t* m, unsigned int what) {
+  _dwm_dirty |= what & (DwmDirtySystray | DwmDirtyClientList);
+  what &= DwmDirtyArrange;
+  if (what & DwmDirtyStack)
+    what |= DwmDirtyBar;
+  if (m)
+    m->dirty |= what;
+  else
+    for (m = dwm_screens; m; m = m->next)
+      m->dirty |= what;
+}
+
+/* Marks the tiled index of m stale. Called whenever the membership or order of
+ * m->clients, the tags of a client, the floating state or the tagset change. */
+static void _dwm_invalidate_tiled(dwm_monitor_t* m) {
+  if (m)
+    m->tiledstale = 1;
+}
+
+static void _dwm_update_tiled(dwm_monitor_t* m) {
+  dwm_client_t* c;
+
+  if (!m->tiledstale)
+    return;
+  m->ntiled = m->nvisible = 0;
+  for (c = m->clients; c; c = c->next) {
+    if (!ISVISIBLE(c))
+      continue;
+    m->nvisible++;
+    if (c->isfloating)
+      continue;
+    if (m->ntiled == m->tiledcap) {
+      m->tiledcap = m->tiledcap ? m->tiledcap * 2 : 16;
+      if (!(m->tiled = realloc(m->tiled, m->tiledcap * sizeof *m->tiled)))
+        die("realloc:");
+    }
+    m->tiled[m->ntiled++] = c;
+  }
+  m->tiledstale = 0;
+}
+
+/* adds c to the member lists of its tags on c->mon */
+static void _dwm_add_tag_members(dwm_client_t* c) {
+  dwm_tag_members_t* t;
+
+  for (unsigned int i = 0; i < LENGTH(c->mon->pertag->members); i++) {
+    if (!(c->tags & 1 << i))
+      continue;
+    t = &c->mon->pertag->members[i];
+    if (t->n == t->capacity) {
+      t->capacity = t->capacity ? t->capacity * 2 : 16;
+      if (!(t->clients = realloc(t->clients, t->capacity * sizeof *t->clients)))
+        die("realloc:");
+    }
+    t->clients[t->n++] = c;
+  }
+}
+
+static void _dwm_remove_tag_members(dwm_client_t* c) {
+  dwm_tag_members_t* t;
+  unsigned int j;
+
+  for (unsigned int i = 0; i < LENGTH(c->mon->pertag->members); i++) {
+    if (!(c->tags & 1 << i))
+      continue;
+    t = &c->mon->pertag->members[i];
+    for (j = 0; j < t->n && t->clients[j] != c; j++)
+      ;
+    if (j < t->n)
+      t->clients[j] = t->clients[--t->n];
+  }
+}
+
+/* The server stacking order of the windows of m is no longer what restack()
+ * set up, e.g. because a window was mapped or raised on top. */
+static void _dwm_invalidate_stacking(dwm_monitor_t* m) {
+  m->raised = None;
+  m->nstacked = 0;
+  m->container = None;
+}
+
+static unsigned int _dwm_lowest_tag(unsigned int tags) {
+  unsigned int i;
+
+  for (i = 0; !(tags & 1 << i); i++)
+    ;
+  return i;
+}
+
+/* With DWM_TAG_CONTAINERS every client is a child of a container window of its
+ * monitor. The visible clients share the container of the lowest viewed tag,
+ * the only one mapped; hidden clients sit in the container of their lowest tag.
+ * Switching between single tags maps one container and unmaps another. Only
+ * clients on several tags and views of several tags move clients between
+ * containers. Containers are created on first use. */
+static Window _dwm_container(dwm_monitor_t* m, unsigned int tag) {
+  XSetWindowAttributes wa
+    = {.override_redirect = True,
+       .background_pixmap = ParentRelative,
+       .event_mask = SubstructureRedirectMask | SubstructureNotifyMask};
+  Window* w = &m->pertag->containers[tag];
+
+  if (*w)
+    return *w;
+  *w = XCreateWindow(dwm_x_display,
+                     dwm_x_window,
+                     m->mx,
+                     m->my,
+                     MAX(m->mw, 1),
+                     MAX(m->mh, 1),
+                     0,
+                     DefaultDepth(dwm_x_display, dwm_x_screen),
+                     CopyFromParent,
+                     DefaultVisual(dwm_x_display, dwm_x_screen),
+                     CWOverrideRedirect | CWBackPixmap | CWEventMask,
+                     &wa);
+  dwm_winmap_insert(*w, DwmWinContainer, NULL, m);
+  XLowerWindow(dwm_x_display, *w); /* below the bars */
+  if (tag == _dwm_lowest_tag(m->tagset[m->seltags]))
+    XMapWindow(dwm_x_display, *w);
+  return *w;
+}
+
+/* the tag of the container c belongs into, see _dwm_container() */
+static unsigned int _dwm_container_tag(dwm_client_t* c) {
+  unsigned int tagset = c->mon->tagset[c->mon->seltags];
+
+  return _dwm_lowest_tag(c->tags & tagset ? tagset : c->tags);
+}
+
+/* moves c into the container it belongs into */
+static void _dwm_update_client_container(dwm_client_t* c) {
+  Window w = _dwm_container(c->mon, _dwm_container_tag(c));
+
+  if (w == c->container)
+    return;
+  /* reparenting a mapped window unmaps it first, see _dwm_hide_client() */
+  if (!c->isunmapped)
+    c->ignoreunmap += 2;
+  if (!c->container) /* back to the root should dwm die */
+    XAddToSaveSet(dwm_x_display, c->win);
+  XReparentWindow(dwm_x_display, c->win, w, PARENTX(c, c->sx), PARENTY(c, c->sy));
+  c->container = w;
+  _dwm_invalidate_stacking(c->mon); /* on top of its new siblings */
+}
+
+/* follows a change of the geometry of m, the clients keep their root position */
+static void _dwm_update_containers(dwm_monitor_t* m) {
+  dwm_client_t* c;
+
+  if (!DWM_TAG_CONTAINERS)
+    return;
+  for (size_t i = 0; i < LENGTH(m->pertag->containers); i++)
+    if (m->pertag->containers[i])
+      XMoveResizeWindow(
+        dwm_x_display, m->pertag->containers[i], m->mx, m->my, m->mw, m->mh);
+  for (c = m->clients; c; c = c->next)
+    XMoveWindow(dwm_x_display, c->win, PARENTX(c, c->sx), PARENTY(c, c->sy));
+}
+
+/* retags c, which is attached to c->mon */
+static void _dwm_set_client_tags(dwm_client_t* c, unsigned int tags) {
+  _dwm_remove_tag_members(c);
+  c->tags = tags;
+  _dwm_add_tag_members(c);
+  _dwm_invalidate_tiled(c->mon);
+}
+
+/* Called at startup and when the keyboard or modifier mapping changes, as it
+ * costs a round trip. Also precomputes the button grabs of focused clients. */
 static void _dwm_update_num_lock_mask() {
-  dwm_num_lock_mask = 0;
+  KeyCode num_lock = XKeysymToKeycode(dwm_x_display, XK_Num_Lock);
   XModifierKeymap* modmap = XGetModifierMapping(dwm_x_display);
+  unsigned int modifiers[4];
+
+  dwm_num_lock_mask = 0;
   for (unsigned i = 0; i < 8; i++)
     for (unsigned j = 0; j < modmap->max_keypermod; j++)
-      if (modmap->modifiermap[i * modmap->max_keypermod + j]
-          == XKeysymToKeycode(dwm_x_display, XK_Num_Lock))
+      if (num_lock && modmap->modifiermap[i * modmap->max_keypermod + j] == num_lock)
         dwm_num_lock_mask = (1 << i);
   XFreeModifiermap(modmap);
+
+  modifiers[0] = 0;
+  modifiers[1] = LockMask;
+  modifiers[2] = dwm_num_lock_mask;
+  modifiers[3] = dwm_num_lock_mask | LockMask;
+  _dwm_button_grab_count = 0;
+  for (unsigned i = 0; i < LENGTH(buttons); i++)
+    if (buttons[i].click == ClkClientWin)
+      for (unsigned j = 0; j < LENGTH(modifiers); j++) {
+        _dwm_button_grabs[_dwm_button_grab_count].button = buttons[i].button;
+        _dwm_button_grabs[_dwm_button_grab_count++].mask = buttons[i].mask | modifiers[j];
+      }
 }
 
+/* An unfocused client has a synchronous grab of every button, so that a click
+ * focuses it in buttonpress(). Added last, that grab takes precedence over the
+ * ClkClientWin grabs of a focused client, thus losing the focus costs a single
+ * request; buttonpress() doesn't replay clicks of bound buttons either way.
+ * Gaining the focus drops all grabs and sets up the precomputed ones. */
 static void _dwm_grab_buttons(dwm_client_t* c, int focused) {
-  _dwm_update_num_lock_mask();
-  unsigned int i, j;
-  unsigned int modifiers[]
-    = {0, LockMask, dwm_num_lock_mask, dwm_num_lock_mask | LockMask};
-  XUngrabButton(dwm_x_display, AnyButton, AnyModifier, c->win);
-  if (!focused)
+  if (c->grabs == (focused ? DwmGrabFocused : DwmGrabUnfocused))
+    return;
+  if (!focused) {
     XGrabButton(dwm_x_display,
                 AnyButton,
                 AnyModifier,
@@ -138,23 +390,25 @@ static void _dwm_grab_buttons(dwm_client_t* c, int focused) {
                 GrabModeSync,
                 None,
                 None);
-  for (i = 0; i < LENGTH(buttons); i++)
-    if (buttons[i].click == ClkClientWin)
-      for (j = 0; j < LENGTH(modifiers); j++)
-        XGrabButton(dwm_x_display,
-                    buttons[i].button,
-                    buttons[i].mask | modifiers[j],
-                    c->win,
-                    False,
-                    BUTTONMASK,
-                    GrabModeAsync,
-                    GrabModeSync,
-                    None,
-                    None);
+    c->grabs = DwmGrabUnfocused;
+    return;
+  }
+  XUngrabButton(dwm_x_display, AnyButton, AnyModifier, c->win);
+  for (unsigned int i = 0; i < _dwm_button_grab_count; i++)
+    XGrabButton(dwm_x_display,
+                _dwm_button_grabs[i].button,
+                _dwm_button_grabs[i].mask,
+                c->win,
+                False,
+                BUTTONMASK,
+                GrabModeAsync,
+                GrabModeSync,
+                None,
+                None);
+  c->grabs = DwmGrabFocused;
 }
 
 static void _dwm_grab_keys() {
-  _dwm_update_num_lock_mask();
   unsigned int i, j;
   unsigned int modifiers[]
     = {0, LockMask, dwm_num_lock_mask, dwm_num_lock_mask | LockMask};
@@ -173,42 +427,52 @@ static void _dwm_grab_keys() {
                  GrabModeAsync);
 }
 
-static void _dwm_update_window_type(dwm_client_t* c) {
-  Atom state = dwm_get_x_atom_property(c, dwm_x_net_atoms[NetWMState]);
-  Atom wtype = dwm_get_x_atom_property(c, dwm_x_net_atoms[NetWMWindowType]);
-
+static void _dwm_set_window_type(dwm_client_t* c, Atom state, Atom wtype) {
   if (state == dwm_x_net_atoms[NetWMFullscreen])
     setfullscreen(c, 1);
-  if (wtype == dwm_x_net_atoms[NetWMWindowTypeDialog])
+  if (wtype == dwm_x_net_atoms[NetWMWindowTypeDialog]) {
     c->isfloating = 1;
+    _dwm_invalidate_tiled(c->mon);
+  }
+}
+
+static void _dwm_update_window_type(dwm_client_t* c) {
+  _dwm_set_window_type(c,
+                       dwm_get_client_state(c),
+                       dwm_get_x_atom_property(c, dwm_x_net_atoms[NetWMWindowType]));
+}
+
+static void _dwm_set_wm_hints(dwm_client_t* c, XWMHints* wmh) {
+  c->wmhints = *wmh;
+  c->haswmhints = 1;
+  if (c == dwm_this_monitor->sel && wmh->flags & XUrgencyHint) {
+    c->wmhints.flags &= ~XUrgencyHint;
+    XSetWMHints(dwm_x_display, c->win, &c->wmhints);
+  } else
+    c->isurgent = (wmh->flags & XUrgencyHint) ? 1 : 0;
+  if (wmh->flags & InputHint)
+    c->neverfocus = !wmh->input;
+  else
+    c->neverfocus = 0;
 }
 
 static void _dwm_update_wm_hints(dwm_client_t* c) {
   XWMHints* wmh;
 
   if ((wmh = XGetWMHints(dwm_x_display, c->win))) {
-    if (c == dwm_this_monitor->sel && wmh->flags & XUrgencyHint) {
-      wmh->flags &= ~XUrgencyHint;
-      XSetWMHints(dwm_x_display, c->win, wmh);
-    } else
-      c->isurgent = (wmh->flags & XUrgencyHint) ? 1 : 0;
-    if (wmh->flags & InputHint)
-      c->neverfocus = !wmh->input;
-    else
-      c->neverfocus = 0;
+    _dwm_set_wm_hints(c, wmh);
     XFree(wmh);
-  }
+  } else
+    c->haswmhints = 0;
 }
 
 static void dwm_set_urgent(dwm_client_t* c, int urg) {
-  XWMHints* wmh;
-
   c->isurgent = urg;
-  if (!(wmh = XGetWMHints(dwm_x_display, c->win)))
+  if (!c->haswmhints)
     return;
-  wmh->flags = urg ? (wmh->flags | XUrgencyHint) : (wmh->flags & ~XUrgencyHint);
-  XSetWMHints(dwm_x_display, c->win, wmh);
-  XFree(wmh);
+  c->wmhints.flags
+    = urg ? (c->wmhints.flags | XUrgencyHint) : (c->wmhints.flags & ~XUrgencyHint);
+  XSetWMHints(dwm_x_display, c->win, &c->wmhints);
 }
 
 static void _dwm_attach_stack(dwm_client_t* c) {
@@ -230,20 +494,122 @@ static void _dwm_detach_stack(dwm_client_t* c) {
   }
 }
 
-static void _dwm_ensure_client_visibility(dwm_client_t* c) {
-  if (!c)
+static int _dwm_move_client_window(dwm_client_t* c, int x, int y) {
+  if (c->sx == x && c->sy == y)
+    return 0;
+  XMoveWindow(dwm_x_display, c->win, PARENTX(c, x), PARENTY(c, y));
+  c->sx = x;
+  c->sy = y;
+  return 1;
+}
+
+static int _dwm_is_hidden(dwm_client_t* c) {
+  if (DWM_TAG_CONTAINERS)
+    return c->container
+           && c->container == c->mon->pertag->containers[_dwm_container_tag(c)]
+           && c->sx == c->x && c->sy == c->y;
+  return DWM_HIDE_BY_UNMAP ? c->isunmapped : c->sx == WIDTH(c) * -2 && c->sy == c->y;
+}
+
+static void _dwm_show_client(dwm_client_t* c) {
+  if (DWM_TAG_CONTAINERS)
+    _dwm_update_client_container(c);
+  _dwm_move_client_window(c, c->x, c->y);
+  if ((!c->mon->lt[c->mon->sellt]->arrange || c->isfloating) && !c->isfullscreen)
+    resize(c, c->x, c->y, c->w, c->h, 0);
+  if (c->isunmapped) {
+    dwm_set_x_window_state(c, NormalState);
+    XMapWindow(dwm_x_display, c->win);
+    c->isunmapped = 0;
+  }
+}
+
+static void _dwm_hide_client(dwm_client_t* c) {
+  if (DWM_TAG_CONTAINERS) {
+    /* hidden by its container, in place for when that is mapped */
+    _dwm_update_client_container(c);
+    _dwm_move_client_window(c, c->x, c->y);
     return;
-  if (ISVISIBLE(c)) {
-    /* show clients top down */
-    XMoveWindow(dwm_x_display, c->win, c->x, c->y);
-    if ((!c->mon->lt[c->mon->sellt]->arrange || c->isfloating) && !c->isfullscreen)
-      resize(c, c->x, c->y, c->w, c->h, 0);
-    _dwm_ensure_client_visibility(c->snext);
-  } else {
-    /* hide clients bottom up */
-    _dwm_ensure_client_visibility(c->snext);
-    XMoveWindow(dwm_x_display, c->win, WIDTH(c) * -2, c->y);
   }
+  if (!DWM_HIDE_BY_UNMAP) {
+    _dwm_move_client_window(c, WIDTH(c) * -2, c->y);
+    return;
+  }
+  if (c->isunmapped)
+    return;
+  /* reported twice, to the root's SubstructureNotify and the client's
+   * StructureNotify selection */
+  c->ignoreunmap += 2;
+  XUnmapWindow(dwm_x_display, c->win);
+  dwm_set_x_window_state(c, IconicState);
+  c->isunmapped = 1;
+}
+
+/* Shows and hides the clients of m whose visibility changed since the tagset
+ * was old. Only the members of the tags in which both tagsets differ are looked
+ * at; a client on several of them is visited once per tag, which is harmless
+ * as moving a window to where it is sends nothing. */
+static void _dwm_update_tag_visibility(dwm_monitor_t* m, unsigned int old) {
+  unsigned int tagset = m->tagset[m->seltags], diff = old ^ tagset, i, j;
+  const dwm_tag_members_t* t;
+  dwm_client_t* c;
+  Window from, to;
+
+  if (DWM_TAG_CONTAINERS) {
+    from = _dwm_container(m, _dwm_lowest_tag(old));
+    to = _dwm_container(m, _dwm_lowest_tag(tagset));
+    for (i = 0; i < LENGTH(m->pertag->members); i++)
+      if ((old | tagset) & 1 << i)
+        for (j = 0; j < m->pertag->members[i].n; j++)
+          _dwm_update_client_container(m->pertag->members[i].clients[j]);
+    if (from != to) {
+      XMapWindow(dwm_x_display, to);
+      XUnmapWindow(dwm_x_display, from);
+    }
+    return;
+  }
+
+  /* show before hiding, like the full pass below */
+  for (int show = 1; show >= 0; show--)
+    for (i = 0; i < LENGTH(m->pertag->members); i++) {
+      if (!(diff & 1 << i))
+        continue;
+      t = &m->pertag->members[i];
+      for (j = 0; j < t->n; j++) {
+        c = t->clients[j];
+        if (!(c->tags & old) == !(c->tags & tagset) || !ISVISIBLE(c) != !show)
+          continue;
+        if (show)
+          _dwm_show_client(c);
+        else
+          _dwm_hide_client(c);
+      }
+    }
+}
+
+static void _dwm_ensure_client_visibility(dwm_client_t* c) {
+  unsigned int n = 0;
+
+  /* show clients top down */
+  for (; c; c = c->snext) {
+    if (!ISVISIBLE(c)) {
+      if (_dwm_is_hidden(c))
+        continue;
+      if (n == _dwm_hide_capacity) {
+        _dwm_hide_capacity = _dwm_hide_capacity ? _dwm_hide_capacity * 2 : 16;
+        _dwm_hide_queue
+          = realloc(_dwm_hide_queue, _dwm_hide_capacity * sizeof *_dwm_hide_queue);
+        if (!_dwm_hide_queue)
+          die("realloc:");
+      }
+      _dwm_hide_queue[n++] = c;
+      continue;
+    }
+    _dwm_show_client(c);
+  }
+  /* hide clients bottom up */
+  while (n)
+    _dwm_hide_client(_dwm_hide_queue[--n]);
 }
 
 static void _dwm_set_client_focus(dwm_client_t* c) {
@@ -258,14 +624,7 @@ static void _dwm_set_client_focus(dwm_client_t* c) {
                     (unsigned char*)&(c->win),
                     1);
   }
-  dwm_send_x_event(c->win,
-                   dwm_x_wm_atoms[WMTakeFocus],
-                   NoEventMask,
-                   dwm_x_wm_atoms[WMTakeFocus],
-                   CurrentTime,
-                   0,
-                   0,
-                   0);
+  dwm_send_wm_protocol(c, dwm_x_wm_atoms[WMTakeFocus]);
 }
 
 void _dwm_unset_client_focus(dwm_client_t* c, int set_x_props) {
@@ -302,126 +661,93 @@ static void _dwm_focus_client(dwm_client_t* c) {
     XDeleteProperty(dwm_x_display, dwm_x_window, dwm_x_net_atoms[NetActiveWindow]);
   }
   dwm_this_monitor->sel = c;
-  drawbars();
+  _dwm_schedule(NULL, DwmDirtyBar | DwmDirtySystray);
 }
 
-static int _dwm_get_text_property(Window w, Atom atom, char* text, unsigned int size) {
+/* interns the text of a property, 0 if it is empty */
+static dwm_title_t _dwm_intern_text_property(XTextProperty* prop) {
   char** list = NULL;
   int n;
-  XTextProperty name;
+  dwm_title_t title = 0;
 
-  if (!text || size == 0)
-    return 0;
-  text[0] = '\0';
-  if (!XGetTextProperty(dwm_x_display, w, &name, atom) || !name.nitems)
-    return 0;
-  if (name.encoding == XA_STRING)
-    strncpy(text, (char*)name.value, size - 1);
-  else {
-    if (XmbTextPropertyToTextList(dwm_x_display, &name, &list, &n) >= Success && n > 0
-        && *list) {
-      strncpy(text, *list, size - 1);
-      XFreeStringList(list);
-    }
+  if (prop->encoding == XA_STRING) {
+    /* values of XCB replies are not NUL terminated */
+    size_t len = strnlen((char*)prop->value, prop->nitems);
+    return len ? dwm_title_intern((char*)prop->value, len) : 0;
   }
-  text[size - 1] = '\0';
-  XFree(name.value);
-  return 1;
+  if (XmbTextPropertyToTextList(dwm_x_display, prop, &list, &n) >= Success && n > 0
+      && *list && **list)
+    title = dwm_title_intern(*list, strlen(*list));
+  if (list)
+    XFreeStringList(list);
+  return title;
+}
+
+static dwm_title_t _dwm_get_title_property(Window w, Atom atom) {
+  XTextProperty prop;
+  dwm_title_t title = 0;
+
+  if (!XGetTextProperty(dwm_x_display, w, &prop, atom))
+    return 0;
+  if (prop.nitems)
+    title = _dwm_intern_text_property(&prop);
+  XFree(prop.value);
+  return title;
 }
 
-static void _dwm_update_title(dwm_client_t* c) {
-  if (!_dwm_get_text_property(
-        c->win, dwm_x_net_atoms[NetWMName], c->name, sizeof c->name))
-    _dwm_get_text_property(c->win, XA_WM_NAME, c->name, sizeof c->name);
+/* returns whether the title changed */
+static int _dwm_replace_title(dwm_client_t* c, dwm_title_t title) {
   // hack to mark broken clients
-  if (c->name[0] == '\0')
-    strcpy(c->name, _dwm_broken_client_title);
-}
-
-static unsigned char const* _get_window_property_data_and_type(
-  Atom atom, Window target_window, long* length, Atom* type, int* size) {
-  Atom actual_type;
-  int actual_format;
-  unsigned long nitems;
-  unsigned long nbytes;
-  unsigned long bytes_after;
-  unsigned char* prop;
-  int status;
-
-  unsigned long max_len = 1024 - 1;
-  status = XGetWindowProperty(dwm_x_display,
-                              target_window,
-                              atom,
-                              0,
-                              max_len,
-                              False,
-                              AnyPropertyType,
-                              &actual_type,
-                              &actual_format,
-                              &nitems,
-                              &bytes_after,
-                              &prop);
-  if (status == BadWindow)
-    return NULL;
-  if (status != Success)
-    return NULL;
-
-  if (actual_format == 32)
-    nbytes = sizeof(long);
-  else if (actual_format == 16)
-    nbytes = sizeof(short);
-  else if (actual_format == 8)
-    nbytes = 1;
-  else if (actual_format == 0)
-    nbytes = 0;
-  else
-    return NULL;
-  *length = nitems * nbytes;
-  if (*length > max_len)
-    *length = max_len;
-  *type = actual_type;
-  *size = actual_format;
-  return prop;
+  if (!title)
+    title = dwm_title_intern(
+      _dwm_broken_client_title, sizeof _dwm_broken_client_title - 1);
+  dwm_title_release(c->title);
+  if (title == c->title)
+    return 0;
+  c->title = title;
+  return 1;
 }
 
-unsigned long _get_pid(Window target_window) {
-  // https://specifications.freedesktop.org/wm-spec/wm-spec-latest.html#idm140200472565744
-  const char* name = "_NET_WM_PID";
+static int _dwm_update_title(dwm_client_t* c) {
+  dwm_title_t title = _dwm_get_title_property(c->win, dwm_x_net_atoms[NetWMName]);
 
-  long length;
-  int size;
-  Atom type;
+  if (!title)
+    title = _dwm_get_title_property(c->win, XA_WM_NAME);
+  return _dwm_replace_title(c, title);
+}
 
-  Atom atom = XInternAtom(dwm_x_display, name, True);
-  if (atom == None) {
-    return 0;
-  }
+static void _dwm_set_title(dwm_client_t* c, const dwm_window_props_t* props) {
+  XTextProperty prop;
+  dwm_title_t title = 0;
 
-  unsigned char const* prop
-    = _get_window_property_data_and_type(atom, target_window, &length, &type, &size);
-  if (!prop || length != 8)
-    return 0;
-  unsigned long pid = *(unsigned long*)prop;
-  return pid;
+  if (dwm_window_props_text(props, DwmPropNetWMName, &prop) && prop.nitems)
+    title = _dwm_intern_text_property(&prop);
+  if (!title && dwm_window_props_text(props, DwmPropWMName, &prop) && prop.nitems)
+    title = _dwm_intern_text_property(&prop);
+  _dwm_replace_title(c, title);
 }
 
-static void _dwm_apply_rules(dwm_client_t* c) {
-  const char* class, *instance;
+static void _dwm_apply_rules(dwm_client_t* c, const dwm_window_props_t* props) {
+  /* WM_CLASS holds both names, neither is longer than the whole */
+  unsigned int size = MAX(dwm_window_props_length(props, DwmPropClass) + 1,
+                          sizeof _dwm_broken_client_title);
+  char class[size], instance[size];
   unsigned int i;
   const Rule* r;
   dwm_monitor_t* m;
-  XClassHint ch = {NULL, NULL};
 
+  if (!dwm_window_props_class(props, instance, class, size)) {
+    strcpy(instance, _dwm_broken_client_title);
+    strcpy(class, _dwm_broken_client_title);
+  }
   /* rule matching */
   c->isfloating = 0;
   c->tags = 0;
-  XGetClassHint(dwm_x_display, c->win, &ch);
-  class = ch.res_class ? ch.res_class : _dwm_broken_client_title;
-  instance = ch.res_name ? ch.res_name : _dwm_broken_client_title;
 
   for (i = 0; i < LENGTH(rules); i++) {
     r = &rules[i];
-    if ((!r->title || strstr(c->name, r->title)) && (!r->class || strstr(class, r->class))
+    if ((!r->title || strstr(dwm_title_text(c->title), r->title))
+        && (!r->class || strstr(class, r->class))
         && (!r->instance || strstr(instance, r->instance))) {
       c->isfloating = r->isfloating;
       c->tags |= r->tags;
@@ -431,10 +757,6 @@ static void _dwm_apply_rules(dwm_client_t* c) {
         c->mon = m;
     }
   }
-  if (ch.res_class)
-    XFree(ch.res_class);
-  if (ch.res_name)
-    XFree(ch.res_name);
   c->tags = c->tags & TAGMASK ? c->tags & TAGMASK : c->mon->tagset[c->mon->seltags];
 }
 
@@ -454,28 +776,122 @@ static dwm_monitor_t* _dwm_dir_to_monitor(int dir) {
   return m;
 }
 
+/* pertag slot of a tagset: the tag if it is a single one, 0 otherwise */
+static unsigned int _dwm_tag_slot(unsigned int tagset) {
+  unsigned int i;
+
+  tagset &= TAGMASK;
+  if (!tagset || tagset & (tagset - 1))
+    return 0;
+  for (i = 0; !(tagset & 1 << i); i++)
+    ;
+  return i + 1;
+}
+
+/* makes the layout state of slot the current one of the selected monitor */
+static void _dwm_select_tag_state(unsigned int slot) {
+  dwm_monitor_t* m = dwm_this_monitor;
+  dwm_pertag_t* pertag = m->pertag;
+
+  pertag->curtag = slot;
+  m->nmaster = pertag->nmasters[slot];
+  m->mfact = pertag->mfacts[slot];
+  m->sellt = pertag->sellts[slot];
+  m->lt[m->sellt] = pertag->ltidxs[slot][m->sellt];
+  m->lt[m->sellt ^ 1] = pertag->ltidxs[slot][m->sellt ^ 1];
+  if (m->showbar != pertag->showbars[slot])
+    togglebar(NULL);
+}
+
+/* Runs kernel over the visible tiled clients of m and configures the ones
+ * whose geometry changed. Requests are flushed with the rest of the batch. */
+static void _dwm_arrange_tiled(dwm_monitor_t* m, dwm_layout_kernel_t kernel) {
+  dwm_layout_input_t in
+    = {0, NULL, m->mfact, m->nmaster, {m->wx, m->wy, m->ww, m->wh}, dwm_bar_height};
+  dwm_client_t* c;
+
+  _dwm_update_tiled(m);
+  in.n = m->ntiled;
+  if (in.n > _dwm_layout_capacity) {
+    _dwm_layout_capacity = MAX(in.n, 2 * _dwm_layout_capacity);
+    _dwm_layout_input
+      = realloc(_dwm_layout_input, _dwm_layout_capacity * sizeof *_dwm_layout_input);
+    _dwm_layout_rects
+      = realloc(_dwm_layout_rects, _dwm_layout_capacity * sizeof *_dwm_layout_rects);
+    if (!_dwm_layout_input || !_dwm_layout_rects)
+      die("realloc:");
+  }
+  for (unsigned int i = 0; i < in.n; i++) {
+    c = m->tiled[i];
+    _dwm_layout_input[i].bw = c->bw;
+    _dwm_layout_input[i].hints = DWM_RESIZE_HINTS ? &c->hints : NULL;
+  }
+  in.clients = _dwm_layout_input;
+  kernel(&in, _dwm_layout_rects);
+  for (unsigned int i = 0; i < in.n; i++) {
+    const dwm_rect_t* r = &_dwm_layout_rects[i];
+    c = m->tiled[i];
+    if (r->x != c->x || r->y != c->y || r->w != c->w || r->h != c->h)
+      resizeclient(c, r->x, r->y, r->w, r->h);
+  }
+}
+
 static void _dwm_arrange_monitor(dwm_monitor_t* m) {
   strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, sizeof m->ltsymbol);
   if (m->lt[m->sellt]->arrange)
     m->lt[m->sellt]->arrange(m);
 }
 
-static void _dwm_arrange_clients(dwm_monitor_t* m) {
-  if (m) {
-    _dwm_ensure_client_visibility(m->stack);
-    _dwm_arrange_monitor(m);
-    restack(m);
-  } else {
-    for (m = dwm_screens; m; m = m->next) {
+/* the only round trip left on the hot path: EnterNotify events caused by
+ * restacking or moving windows have to be on the queue before they can be
+ * dropped, or they would move the focus */
+static void _dwm_drop_crossing_events() {
+  XEvent ev;
+
+  dwm_x_sync(False);
+  while (XCheckMaskEvent(dwm_x_display, EnterWindowMask, &ev))
+    ;
+  dwm_discard_batched_x_events(EnterNotify);
+}
+
+static void _dwm_flush_scheduled() {
+  dwm_monitor_t* m;
+  unsigned int dirty = _dwm_dirty;
+  dwm_stats_scope_t stats = dwm_stats_begin(DwmStatFlush);
+
+  for (m = dwm_screens; m; m = m->next)
+    dirty |= m->dirty;
+  if (!dirty)
+    return; /* not accounted, most batches schedule nothing */
+  for (m = dwm_screens; m; m = m->next) {
+    dirty = m->dirty;
+    m->dirty = 0;
+    if (dirty & DwmDirtyVisibility)
       _dwm_ensure_client_visibility(m->stack);
+    if (dirty & DwmDirtyLayout)
       _dwm_arrange_monitor(m);
-    }
+    if (dirty & DwmDirtyStack
+        && (restack(m) || dirty & (DwmDirtyLayout | DwmDirtyVisibility)))
+      _dwm_drop_crossing_events();
+    if (dirty & DwmDirtyBar)
+      drawbar(m);
   }
+  dirty = _dwm_dirty;
+  _dwm_dirty = 0;
+  if (dirty & DwmDirtySystray)
+    dwm_update_systray();
+  if (dirty & DwmDirtyClientList)
+    updateclientlist();
+  dwm_stats_end(&stats);
 }
 
 static void _dwm_attach_client_to_monitor(dwm_client_t* c) {
   c->next = c->mon->clients;
   c->mon->clients = c;
+  _dwm_add_tag_members(c);
+  if (DWM_TAG_CONTAINERS)
+    _dwm_update_client_container(c);
+  _dwm_invalidate_tiled(c->mon);
 }
 
 static void _dwm_clean_up_monitor(dwm_monitor_t* mon) {
@@ -488,26 +904,58 @@ static void _dwm_clean_up_monitor(dwm_monitor_t* mon) {
       ;
     m->next = mon->next;
   }
+  dwm_winmap_remove(mon->barwin);
   XUnmapWindow(dwm_x_display, mon->barwin);
   XDestroyWindow(dwm_x_display, mon->barwin);
+  for (size_t i = 0; i < LENGTH(mon->pertag->members); i++) {
+    free(mon->pertag->members[i].clients);
+    if (mon->pertag->containers[i]) {
+      dwm_winmap_remove(mon->pertag->containers[i]);
+      XDestroyWindow(dwm_x_display, mon->pertag->containers[i]);
+    }
+  }
+  free(mon->pertag);
+  free(mon->tiled);
+  free(mon->stacked);
   free(mon);
 }
 
+static int _dwm_is_bound(const Button* b,
+                         unsigned int click,
+                         const XButtonPressedEvent* ev) {
+  return click == b->click && b->func && b->button == ev->button
+         && CLEANMASK(b->mask) == CLEANMASK(ev->state);
+}
+
+/* wintomon() for a window already looked up in the registry */
+static dwm_monitor_t* _dwm_win_to_monitor(Window w, dwm_win_t win) {
+  int x, y;
+
+  if (w == dwm_x_window && getrootptr(&x, &y))
+    return recttomon(x, y, 1, 1);
+  if (win.kind == DwmWinBar || win.kind == DwmWinContainer)
+    return win.mon;
+  if (win.kind == DwmWinClient)
+    return win.client->mon;
+  return dwm_this_monitor;
+}
+
 void buttonpress(XEvent* e) {
   unsigned int i, x, click;
   Arg arg = {0};
   dwm_client_t* c;
   dwm_monitor_t* m;
   XButtonPressedEvent* ev = &e->xbutton;
+  dwm_win_t win = dwm_winmap_find(ev->window);
 
   click = ClkRootWin;
   /* focus monitor if necessary */
-  if ((m = wintomon(ev->window)) && m != dwm_this_monitor) {
+  if ((m = _dwm_win_to_monitor(ev->window, win)) && m != dwm_this_monitor) {
     _dwm_unset_client_focus(dwm_this_monitor->sel, 1);
     dwm_this_monitor = m;
     _dwm_focus_client(NULL);
   }
-  if (ev->window == dwm_this_monitor->barwin) {
+  if (win.kind == DwmWinBar) {
     i = x = 0;
     do
       x += TEXTW(tags[i]);
@@ -521,37 +969,42 @@ void buttonpress(XEvent* e) {
       click = ClkStatusText;
     else
       click = ClkWinTitle;
-  } else if ((c = wintoclient(ev->window))) {
+  } else if (win.kind == DwmWinClient) {
+    c = win.client;
     _dwm_focus_client(c);
-    restack(dwm_this_monitor);
-    XAllowEvents(dwm_x_display, ReplayPointer, CurrentTime);
+    _dwm_schedule(dwm_this_monitor, DwmDirtyStack);
     click = ClkClientWin;
+    /* bound clicks stay with dwm, see _dwm_grab_buttons() */
+    for (i = 0; i < LENGTH(buttons) && !_dwm_is_bound(&buttons[i], click, ev); i++)
+      ;
+    XAllowEvents(
+      dwm_x_display, i < LENGTH(buttons) ? AsyncPointer : ReplayPointer, CurrentTime);
   }
   for (i = 0; i < LENGTH(buttons); i++)
-    if (click == buttons[i].click && buttons[i].func && buttons[i].button == ev->button
-        && CLEANMASK(buttons[i].mask) == CLEANMASK(ev->state))
+    if (_dwm_is_bound(&buttons[i], click, ev)) {
+      _dwm_action_latency = &_dwm_button_latency[i];
+      _dwm_action_start_us = dwm_stats_now_us();
       buttons[i].func(click == ClkTagBar && buttons[i].arg.i == 0 ? &arg
                                                                   : &buttons[i].arg);
+    }
 }
 
 void clientmessage(XEvent* e) {
   XClientMessageEvent* cme = &e->xclient;
+  dwm_win_t win = dwm_winmap_find(cme->window);
+  dwm_client_t* c;
 
-  if (dwm_is_systray_window(cme->window)
-      && cme->message_type == dwm_x_net_atoms[NetSystemTrayOP]) {
-    if (cme->data.l[1] == SYSTEM_TRAY_REQUEST_DOCK) {
-      dwm_client_t* c = dwm_add_systray_icon(cme->data.l[2]);
-      move_resize_bar(dwm_this_monitor);
-      dwm_update_systray();
+  if (win.kind == DwmWinTray && cme->message_type == dwm_x_net_atoms[NetSystemTrayOP]) {
+    if (cme->data.l[1] == SYSTEM_TRAY_REQUEST_DOCK
+        && (c = dwm_add_systray_icon(cme->data.l[2]))) {
+      _dwm_schedule(dwm_this_monitor, DwmDirtyBar | DwmDirtySystray);
       dwm_set_x_window_state(c, NormalState);
     }
     return;
   }
-
-  dwm_client_t* c = wintoclient(cme->window);
-
-  if (!c)
+  if (win.kind != DwmWinClient)
     return;
+  c = win.client;
   if (cme->message_type == dwm_x_net_atoms[NetWMState]) {
     if (cme->data.l[1] == dwm_x_net_atoms[NetWMFullscreen]
         || cme->data.l[2] == dwm_x_net_atoms[NetWMFullscreen])
@@ -603,7 +1056,7 @@ void configurenotify(XEvent* e) {
         move_resize_bar(m);
       }
       _dwm_focus_client(NULL);
-      _dwm_arrange_clients(NULL);
+      _dwm_schedule(NULL, DwmDirtyArrange);
     }
   }
 }
@@ -641,8 +1094,12 @@ void configurerequest(XEvent* e) {
         c->y = m->my + (m->mh / 2 - HEIGHT(c) / 2); /* center in y direction */
       if ((ev->value_mask & (CWX | CWY)) && !(ev->value_mask & (CWWidth | CWHeight)))
         configure(c);
-      if (ISVISIBLE(c))
-        XMoveResizeWindow(dwm_x_display, c->win, c->x, c->y, c->w, c->h);
+      if (ISVISIBLE(c)) {
+        XMoveResizeWindow(
+          dwm_x_display, c->win, PARENTX(c, c->x), PARENTY(c, c->y), c->w, c->h);
+        c->sx = c->x;
+        c->sy = c->y;
+      }
     } else
       configure(c);
   } else {
@@ -655,7 +1112,6 @@ void configurerequest(XEvent* e) {
     wc.stack_mode = ev->detail;
     XConfigureWindow(dwm_x_display, ev->window, ev->value_mask, &wc);
   }
-  XSync(dwm_x_display, False);
 }
 
 dwm_monitor_t* createmon(void) {
@@ -670,19 +1126,27 @@ dwm_monitor_t* createmon(void) {
   m->lt[0] = &layouts[0];
   m->lt[1] = &layouts[1 % LENGTH(layouts)];
   strncpy(m->ltsymbol, layouts[0].symbol, sizeof m->ltsymbol);
+  m->pertag = ecalloc(1, sizeof(dwm_pertag_t));
+  m->pertag->curtag = 1;
+  for (size_t i = 0; i <= LENGTH(tags); i++) {
+    m->pertag->nmasters[i] = m->nmaster;
+    m->pertag->mfacts[i] = m->mfact;
+    m->pertag->ltidxs[i][0] = m->lt[0];
+    m->pertag->ltidxs[i][1] = m->lt[1];
+    m->pertag->showbars[i] = m->showbar;
+  }
   return m;
 }
 
 void destroynotify(XEvent* e) {
-  dwm_client_t* c;
   XDestroyWindowEvent* ev = &e->xdestroywindow;
+  dwm_win_t win = dwm_winmap_find(ev->window);
 
-  if ((c = wintoclient(ev->window))) {
-    unmanage(c, 1);
-  } else if ((c = dwm_find_systray_icon_client(ev->window))) {
-    dwm_remove_systray_icon(c);
-    move_resize_bar(dwm_this_monitor);
-    dwm_update_systray();
+  if (win.kind == DwmWinClient) {
+    unmanage(win.client, 1);
+  } else if (win.kind == DwmWinTrayIcon) {
+    dwm_remove_systray_icon(win.client);
+    _dwm_schedule(dwm_this_monitor, DwmDirtyBar | DwmDirtySystray);
   }
 }
 
@@ -692,6 +1156,8 @@ void detach(dwm_client_t* c) {
   for (tc = &c->mon->clients; *tc && *tc != c; tc = &(*tc)->next)
     ;
   *tc = c->next;
+  _dwm_remove_tag_members(c);
+  _dwm_invalidate_tiled(c->mon);
 
   if (c == c->mon->scratchpad) {
     c->mon->scratchpad = NULL;
@@ -705,6 +1171,7 @@ void drawbar(dwm_monitor_t* monitor) {
   int boxw = dwm_drw->fonts->h / 6 + 2;
   unsigned int i, occ = 0, urg = 0;
   dwm_client_t* c;
+  dwm_stats_scope_t stats = dwm_stats_begin(DwmStatDrawbar);
 
   if (monitor == dwm_find_systray_monitor(monitor)) {
     systray_width = dwm_calculate_systray_width();
@@ -744,7 +1211,17 @@ void drawbar(dwm_monitor_t* monitor) {
       dwm_drw_setscheme(
         dwm_drw,
         dwm_color_schemes[monitor == dwm_this_monitor ? DwmThisScheme : DwmNormalScheme]);
-      dwm_drw_text(dwm_drw, x, 0, w, dwm_bar_height, lrpad / 2, monitor->sel->name, 0);
+      dwm_title_t title = monitor->sel->title;
+      dwm_drw_measured_text(dwm_drw,
+                            x,
+                            0,
+                            w,
+                            dwm_bar_height,
+                            lrpad / 2,
+                            dwm_title_text(title),
+                            dwm_title_len(title),
+                            dwm_title_width(title),
+                            0);
       if (monitor->sel->isfloating)
         dwm_drw_rect(dwm_drw, x + boxs, boxs, boxw, boxw, monitor->sel->isfixed, 0);
     } else {
@@ -753,14 +1230,7 @@ void drawbar(dwm_monitor_t* monitor) {
     }
   }
   dwm_drw_map(dwm_drw, monitor->barwin, 0, 0, monitor->ww, dwm_bar_height);
-}
-
-void drawbars(void) {
-  dwm_monitor_t* m;
-
-  for (m = dwm_screens; m; m = m->next)
-    drawbar(m);
-  dwm_update_systray();
+  dwm_stats_end(&stats);
 }
 
 void enternotify(XEvent* e) {
@@ -785,11 +1255,9 @@ void expose(XEvent* e) {
   dwm_monitor_t* m;
   XExposeEvent* ev = &e->xexpose;
 
-  if (ev->count == 0 && (m = wintomon(ev->window))) {
-    drawbar(m);
-    if (m == dwm_this_monitor)
-      dwm_update_systray();
-  }
+  if (ev->count == 0 && (m = wintomon(ev->window)))
+    _dwm_schedule(m,
+                  m == dwm_this_monitor ? DwmDirtyBar | DwmDirtySystray : DwmDirtyBar);
 }
 
 /* there are some broken focus acquiring clients needing extra handling */
@@ -834,7 +1302,7 @@ void focusstack(const Arg* arg) {
   }
   if (c) {
     _dwm_focus_client(c);
-    restack(dwm_this_monitor);
+    _dwm_schedule(dwm_this_monitor, DwmDirtyStack);
   }
 }
 
@@ -874,8 +1342,11 @@ long getstate(Window w) {
 }
 
 void incnmaster(const Arg* arg) {
-  dwm_this_monitor->nmaster = MAX(dwm_this_monitor->nmaster + arg->i, 0);
-  _dwm_arrange_clients(dwm_this_monitor);
+  dwm_pertag_t* pertag = dwm_this_monitor->pertag;
+
+  dwm_this_monitor->nmaster = pertag->nmasters[pertag->curtag]
+    = MAX(dwm_this_monitor->nmaster + arg->i, 0);
+  _dwm_schedule(dwm_this_monitor, DwmDirtyArrange);
 }
 
 #ifdef XINERAMA
@@ -898,33 +1369,28 @@ void keypress(XEvent* e) {
   keysym = XkbKeycodeToKeysym(dwm_x_display, (KeyCode)ev->keycode, 0, 0);
   for (i = 0; i < LENGTH(keys); i++)
     if (keysym == keys[i].keysym && CLEANMASK(keys[i].mod) == CLEANMASK(ev->state)
-        && keys[i].func)
+        && keys[i].func) {
+      _dwm_action_latency = &_dwm_key_latency[i];
+      _dwm_action_start_us = dwm_stats_now_us();
       keys[i].func(&(keys[i].arg));
+    }
 }
 
 void killclient(const Arg* arg) {
   if (!dwm_this_monitor->sel)
     return;
-  if (!dwm_send_x_event(dwm_this_monitor->sel->win,
-                        dwm_x_wm_atoms[WMDelete],
-                        NoEventMask,
-                        dwm_x_wm_atoms[WMDelete],
-                        CurrentTime,
-                        0,
-                        0,
-                        0)) {
+  if (!dwm_send_wm_protocol(dwm_this_monitor->sel, dwm_x_wm_atoms[WMDelete])) {
     XGrabServer(dwm_x_display);
     XSetErrorHandler(xerrordummy);
     XSetCloseDownMode(dwm_x_display, DestroyAll);
     XKillClient(dwm_x_display, dwm_this_monitor->sel->win);
-    XSync(dwm_x_display, False);
+    dwm_x_sync(False);
     XSetErrorHandler(xerror);
     XUngrabServer(dwm_x_display);
   }
 }
 
-dwm_monitor_t* get_scratchpad_monitor(Window w) {
-  unsigned long pid = _get_pid(w);
+dwm_monitor_t* get_scratchpad_monitor(unsigned long pid) {
   if (pid) {
     dwm_monitor_t* m = dwm_screens;
     for (; m && m->scratchpadpid != pid; m = m->next)
@@ -938,9 +1404,15 @@ void manage(Window w, XWindowAttributes* wa) {
   dwm_client_t *c, *t = NULL;
   Window trans = None;
   XWindowChanges wc;
-  dwm_monitor_t* scratchpadmon = get_scratchpad_monitor(w);
-
-  c = ecalloc(1, sizeof(dwm_client_t));
+  XSizeHints size;
+  XWMHints wmh;
+  dwm_window_props_t props;
+  dwm_monitor_t* scratchpadmon;
+  dwm_stats_scope_t stats = dwm_stats_begin(DwmStatManage);
+
+  /* one round trip for all properties instead of one each */
+  dwm_request_window_props(w, &props);
+  c = dwm_alloc_client();
   c->win = w;
   /* geometry */
   c->x = c->oldx = wa->x;
@@ -948,9 +1420,13 @@ void manage(Window w, XWindowAttributes* wa) {
   c->w = c->oldw = wa->width;
   c->h = c->oldh = wa->height;
   c->oldbw = wa->border_width;
+  c->isunmapped = wa->map_state != IsViewable;
 
-  _dwm_update_title(c);
-  if (XGetTransientForHint(dwm_x_display, w, &trans) && (t = wintoclient(trans))) {
+  dwm_collect_window_props(&props);
+  scratchpadmon = get_scratchpad_monitor(dwm_window_props_cardinal(&props, DwmPropPid));
+  _dwm_set_title(c, &props);
+  trans = dwm_window_props_window(&props, DwmPropTransientFor);
+  if (trans != None && (t = wintoclient(trans))) {
     c->mon = t->mon;
     c->tags = t->tags;
   } else if (scratchpadmon) {
@@ -959,7 +1435,7 @@ void manage(Window w, XWindowAttributes* wa) {
     scratchpadmon->scratchpadpid = 0;
   } else {
     c->mon = dwm_this_monitor;
-    _dwm_apply_rules(c);
+    _dwm_apply_rules(c, &props);
   }
 
   if (scratchpadmon) {
@@ -992,9 +1468,17 @@ void manage(Window w, XWindowAttributes* wa) {
   XSetWindowBorder(
     dwm_x_display, w, dwm_color_schemes[DwmNormalScheme][DwmBorderColor].pixel);
   configure(c); /* propagates border_width, if size doesn't change */
-  _dwm_update_window_type(c);
-  dwm_update_size_hints(c);
-  _dwm_update_wm_hints(c);
+  c->winstate = dwm_window_props_atom(&props, DwmPropNetWMState);
+  _dwm_set_window_type(
+    c, c->winstate, dwm_window_props_atom(&props, DwmPropNetWMWindowType));
+  dwm_set_size_hints(c, dwm_window_props_size_hints(&props, &size) ? &size : NULL);
+  if (dwm_window_props_wm_hints(&props, &wmh))
+    _dwm_set_wm_hints(c, &wmh);
+  if (dwm_window_props_has_atom(&props, DwmPropProtocols, dwm_x_wm_atoms[WMDelete]))
+    c->protocols |= DwmProtoDelete;
+  if (dwm_window_props_has_atom(&props, DwmPropProtocols, dwm_x_wm_atoms[WMTakeFocus]))
+    c->protocols |= DwmProtoTakeFocus;
+  dwm_release_window_props(&props);
   XSelectInput(dwm_x_display,
                w,
                EnterWindowMask | FocusChangeMask | PropertyChangeMask
@@ -1004,8 +1488,10 @@ void manage(Window w, XWindowAttributes* wa) {
     c->isfloating = c->oldstate = trans != None || c->isfixed;
   if (c->isfloating)
     XRaiseWindow(dwm_x_display, c->win);
+  _dwm_invalidate_stacking(c->mon); /* new windows are on top */
   _dwm_attach_client_to_monitor(c);
   _dwm_attach_stack(c);
+  dwm_winmap_insert(c->win, DwmWinClient, c, NULL);
   XChangeProperty(dwm_x_display,
                   dwm_x_window,
                   dwm_x_net_atoms[NetClientList],
@@ -1016,57 +1502,66 @@ void manage(Window w, XWindowAttributes* wa) {
                   1);
   XMoveResizeWindow(dwm_x_display,
                     c->win,
-                    c->x + 2 * dwm_x_screen_width,
-                    c->y,
+                    PARENTX(c, c->x + 2 * dwm_x_screen_width),
+                    PARENTY(c, c->y),
                     c->w,
                     c->h); /* some windows require this */
+  c->sx = c->x + 2 * dwm_x_screen_width;
+  c->sy = c->y;
   dwm_set_x_window_state(c, NormalState);
   if (c->mon == dwm_this_monitor)
     _dwm_unset_client_focus(dwm_this_monitor->sel, 0);
   c->mon->sel = c;
-  _dwm_arrange_clients(c->mon);
+  _dwm_schedule(c->mon, DwmDirtyArrange);
   XMapWindow(dwm_x_display, c->win);
+  c->isunmapped = 0;
   _dwm_focus_client(NULL);
+  dwm_stats_end(&stats);
 }
 
 void mappingnotify(XEvent* e) {
   XMappingEvent* ev = &e->xmapping;
 
+  dwm_monitor_t* m;
+  dwm_client_t* c;
+
   XRefreshKeyboardMapping(ev);
-  if (ev->request == MappingKeyboard)
-    _dwm_grab_keys();
+  if (ev->request != MappingKeyboard && ev->request != MappingModifier)
+    return;
+  _dwm_update_num_lock_mask();
+  _dwm_grab_keys();
+  for (m = dwm_screens; m; m = m->next)
+    for (c = m->clients; c; c = c->next)
+      if (c->grabs == DwmGrabFocused) {
+        c->grabs = DwmGrabNone;
+        _dwm_grab_buttons(c, 1);
+      }
 }
 
 void maprequest(XEvent* e) {
   static XWindowAttributes wa;
   XMapRequestEvent* ev = &e->xmaprequest;
+  dwm_win_t win = dwm_winmap_find(ev->window);
 
-  dwm_client_t* i;
-  if ((i = dwm_find_systray_icon_client(ev->window))) {
-    dwm_send_systray_icon_window_active(i->win);
-    move_resize_bar(dwm_this_monitor);
-    dwm_update_systray();
+  if (win.kind == DwmWinTrayIcon) {
+    dwm_send_systray_icon_window_active(ev->window);
+    _dwm_schedule(dwm_this_monitor, DwmDirtyBar | DwmDirtySystray);
   }
 
   if (!XGetWindowAttributes(dwm_x_display, ev->window, &wa))
     return;
   if (wa.override_redirect)
     return;
-  if (!wintoclient(ev->window))
+  /* a window known as anything else, e.g. a tray icon, is no client */
+  if (win.kind == DwmWinNone)
     manage(ev->window, &wa);
 }
 
 void monocle(dwm_monitor_t* m) {
-  unsigned int n = 0;
-  dwm_client_t* c;
-
-  for (c = m->clients; c; c = c->next)
-    if (ISVISIBLE(c))
-      n++;
-  if (n > 0) /* override layout symbol */
-    snprintf(m->ltsymbol, sizeof m->ltsymbol, "[%d]", n);
-  for (c = nexttiled(m->clients); c; c = nexttiled(c->next))
-    resize(c, m->wx, m->wy, m->ww - 2 * c->bw, m->wh - 2 * c->bw, 0);
+  _dwm_update_tiled(m);
+  if (m->nvisible > 0) /* override layout symbol */
+    snprintf(m->ltsymbol, sizeof m->ltsymbol, "[%u]", m->nvisible);
+  _dwm_arrange_tiled(m, dwm_layout_monocle);
 }
 
 void motionnotify(XEvent* e) {
@@ -1095,7 +1590,8 @@ void movemouse(const Arg* arg) {
     return;
   if (c->isfullscreen) /* no support moving fullscreen windows by mouse */
     return;
-  restack(dwm_this_monitor);
+  _dwm_schedule(dwm_this_monitor, DwmDirtyStack);
+  _dwm_flush_scheduled();
   ocx = c->x;
   ocy = c->y;
   if (XGrabPointer(dwm_x_display,
@@ -1118,6 +1614,7 @@ void movemouse(const Arg* arg) {
     case Expose:
     case MapRequest:
       drw_x_event_handlers[ev.type](&ev);
+      _dwm_flush_scheduled();
       break;
     case MotionNotify:
       if ((ev.xmotion.time - lasttime) <= (1000 / 60))
@@ -1141,6 +1638,7 @@ void movemouse(const Arg* arg) {
         togglefloating(NULL);
       if (!dwm_this_monitor->lt[dwm_this_monitor->sellt]->arrange || c->isfloating)
         resize(c, nx, ny, c->w, c->h, 1);
+      _dwm_flush_scheduled();
       break;
     }
   } while (ev.type != ButtonRelease);
@@ -1152,62 +1650,63 @@ void movemouse(const Arg* arg) {
   }
 }
 
-dwm_client_t* nexttiled(dwm_client_t* c) {
-  for (; c && (c->isfloating || !ISVISIBLE(c)); c = c->next)
-    ;
-  return c;
-}
-
 void pop(dwm_client_t* c) {
   detach(c);
   _dwm_attach_client_to_monitor(c);
   _dwm_focus_client(c);
-  _dwm_arrange_clients(c->mon);
+  _dwm_schedule(c->mon, DwmDirtyArrange);
 }
 
 void propertynotify(XEvent* e) {
   dwm_client_t* c;
   Window trans;
   XPropertyEvent* ev = &e->xproperty;
+  dwm_win_t win = dwm_winmap_find(ev->window);
 
-  if ((c = dwm_find_systray_icon_client(ev->window))) {
+  if (win.kind == DwmWinTrayIcon) {
+    c = win.client;
     if (ev->atom == XA_WM_NORMAL_HINTS) {
       dwm_update_size_hints(c);
       dwm_update_systray_icon_geom(c, c->w, c->h);
     } else
       dwm_update_systray_icon_state(c, ev);
-    move_resize_bar(dwm_this_monitor);
-    dwm_update_systray();
+    _dwm_schedule(dwm_this_monitor, DwmDirtyBar | DwmDirtySystray);
   }
 
   if ((ev->window == dwm_x_window) && (ev->atom == XA_WM_NAME))
-    drawbar(dwm_this_monitor);
-  else if (ev->state == PropertyDelete)
-    return; /* ignore */
-  else if ((c = wintoclient(ev->window))) {
+    _dwm_schedule(dwm_this_monitor, DwmDirtyBar);
+  else if (ev->state == PropertyDelete) {
+    if (win.kind == DwmWinClient)
+      dwm_drop_client_property(win.client, ev->atom);
+  } else if (win.kind == DwmWinClient) {
+    c = win.client;
+    dwm_invalidate_client_property(c, ev->atom);
     switch (ev->atom) {
     default:
       break;
     case XA_WM_TRANSIENT_FOR:
       if (!c->isfloating && (XGetTransientForHint(dwm_x_display, c->win, &trans))
-          && (c->isfloating = (wintoclient(trans)) != NULL))
-        _dwm_arrange_clients(c->mon);
+          && (c->isfloating = (wintoclient(trans)) != NULL)) {
+        _dwm_invalidate_tiled(c->mon);
+        _dwm_schedule(c->mon, DwmDirtyArrange);
+      }
       break;
     case XA_WM_NORMAL_HINTS:
       dwm_update_size_hints(c);
       break;
     case XA_WM_HINTS:
       _dwm_update_wm_hints(c);
-      drawbars();
+      _dwm_schedule(NULL, DwmDirtyBar | DwmDirtySystray);
       break;
     }
     if (ev->atom == XA_WM_NAME || ev->atom == dwm_x_net_atoms[NetWMName]) {
-      _dwm_update_title(c);
-      if (c == c->mon->sel)
-        drawbar(c->mon);
+      if (_dwm_update_title(c) && c == c->mon->sel)
+        _dwm_schedule(c->mon, DwmDirtyBar);
     }
     if (ev->atom == dwm_x_net_atoms[NetWMWindowType])
       _dwm_update_window_type(c);
+    if (ev->atom == dwm_x_wm_atoms[WMProtocols])
+      dwm_update_wm_protocols(c);
   }
 }
 
@@ -1231,8 +1730,7 @@ void resizerequest(XEvent* e) {
 
   if ((i = dwm_find_systray_icon_client(ev->window))) {
     dwm_update_systray_icon_geom(i, ev->width, ev->height);
-    move_resize_bar(dwm_this_monitor);
-    dwm_update_systray();
+    _dwm_schedule(dwm_this_monitor, DwmDirtyBar | DwmDirtySystray);
   }
 }
 
@@ -1252,9 +1750,11 @@ void resizeclient(dwm_client_t* c, int x, int y, int w, int h) {
   XWindowChanges wc;
 
   c->oldx = c->x;
-  c->x = wc.x = x;
+  c->x = x;
+  wc.x = PARENTX(c, x);
   c->oldy = c->y;
-  c->y = wc.y = y;
+  c->y = y;
+  wc.y = PARENTY(c, y);
   c->oldw = c->w;
   c->w = wc.width = w;
   c->oldh = c->h;
@@ -1262,8 +1762,9 @@ void resizeclient(dwm_client_t* c, int x, int y, int w, int h) {
   wc.border_width = c->bw;
   XConfigureWindow(
     dwm_x_display, c->win, CWX | CWY | CWWidth | CWHeight | CWBorderWidth, &wc);
+  c->sx = x;
+  c->sy = y;
   configure(c);
-  XSync(dwm_x_display, False);
 }
 
 void resizemouse(const Arg* arg) {
@@ -1277,7 +1778,8 @@ void resizemouse(const Arg* arg) {
     return;
   if (c->isfullscreen) /* no support resizing fullscreen windows by mouse */
     return;
-  restack(dwm_this_monitor);
+  _dwm_schedule(dwm_this_monitor, DwmDirtyStack);
+  _dwm_flush_scheduled();
   ocx = c->x;
   ocy = c->y;
   if (XGrabPointer(dwm_x_display,
@@ -1300,6 +1802,7 @@ void resizemouse(const Arg* arg) {
     case Expose:
     case MapRequest:
       drw_x_event_handlers[ev.type](&ev);
+      _dwm_flush_scheduled();
       break;
     case MotionNotify:
       if ((ev.xmotion.time - lasttime) <= (1000 / 60))
@@ -1318,6 +1821,7 @@ void resizemouse(const Arg* arg) {
       }
       if (!dwm_this_monitor->lt[dwm_this_monitor->sellt]->arrange || c->isfloating)
         resize(c, c->x, c->y, nw, nh, 1);
+      _dwm_flush_scheduled();
       break;
     }
   } while (ev.type != ButtonRelease);
@@ -1333,37 +1837,200 @@ void resizemouse(const Arg* arg) {
   }
 }
 
-void restack(dwm_monitor_t* m) {
-  dwm_client_t* c;
-  XEvent ev;
-  XWindowChanges wc;
+static int _dwm_overlap(const dwm_client_t* a, const dwm_client_t* b) {
+  return a->x < b->x + WIDTH(b) && b->x < a->x + WIDTH(a) && a->y < b->y + HEIGHT(b)
+         && b->y < a->y + HEIGHT(a);
+}
+
+/* Whether the tiled clients as last stacked look the same as when stacked in
+ * the order of the n clients at d, that is whether every pair of overlapping
+ * clients is in the right order. Non-overlapping tiles need no restack when
+ * the focus moves between them. Only clients with a later one stacked below
+ * them are compared with the others, which is one or two on a focus change; if
+ * too many moved, restacking is cheaper than finding out. */
+static int _dwm_stacking_holds(dwm_monitor_t* m, dwm_client_t** d, unsigned int n) {
+  unsigned int i, j, min = n, budget = 4 * n;
+
+  if (n != m->nstacked)
+    return 0;
+  for (i = 0; i < n; i++)
+    if (d[i]->stackpos >= n || m->stacked[d[i]->stackpos] != d[i])
+      return 0;
+  for (i = n; i--; min = MIN(min, d[i]->stackpos)) {
+    if (d[i]->stackpos < min)
+      continue;
+    for (j = i + 1; j < n; j++) {
+      if (!budget--)
+        return 0;
+      if (d[j]->stackpos < d[i]->stackpos && _dwm_overlap(d[i], d[j]))
+        return 0;
+    }
+  }
+  return 1;
+}
+
+/* Raises a floating selection and stacks the tiled clients below the bar in
+ * focus order. Keeps a model of what it set up and sends only what changed,
+ * the tiled clients with a single XRestackWindows(). Returns whether anything
+ * was sent. */
+int restack(dwm_monitor_t* m) {
+  dwm_client_t *c, **d;
+  Window* w;
+  unsigned int i, n = 0;
+  int sent = 0;
+  dwm_stats_scope_t stats;
 
-  drawbar(m);
   if (!m->sel)
-    return;
-  if (m->sel->isfloating || !m->lt[m->sellt]->arrange)
+    return 0;
+  stats = dwm_stats_begin(DwmStatRestack);
+  if ((m->sel->isfloating || !m->lt[m->sellt]->arrange) && m->raised != m->sel->win) {
     XRaiseWindow(dwm_x_display, m->sel->win);
+    m->raised = m->sel->win;
+    /* above the bar now, out of the order last stacked */
+    if (m->sel->stackpos < m->nstacked && m->stacked[m->sel->stackpos] == m->sel)
+      m->nstacked = 0;
+    sent = 1;
+  }
+  /* a fullscreen client covers the bar along with its container */
+  if (DWM_TAG_CONTAINERS && m->sel->container
+      && (m->container != m->sel->container
+          || m->containerraised != m->sel->isfullscreen)) {
+    if (m->sel->isfullscreen)
+      XRaiseWindow(dwm_x_display, m->sel->container);
+    else
+      XLowerWindow(dwm_x_display, m->sel->container);
+    m->container = m->sel->container;
+    m->containerraised = m->sel->isfullscreen;
+    sent = 1;
+  }
   if (m->lt[m->sellt]->arrange) {
-    wc.stack_mode = Below;
-    wc.sibling = m->barwin;
+    /* the wanted order goes after the model */
     for (c = m->stack; c; c = c->snext)
       if (!c->isfloating && ISVISIBLE(c)) {
-        XConfigureWindow(dwm_x_display, c->win, CWSibling | CWStackMode, &wc);
-        wc.sibling = c->win;
+        if (m->nstacked + n == m->stackedcap) {
+          m->stackedcap = MAX(64, 2 * m->stackedcap);
+          if (!(m->stacked = realloc(m->stacked, m->stackedcap * sizeof *m->stacked)))
+            die("realloc:");
+        }
+        m->stacked[m->nstacked + n++] = c;
+      }
+    d = m->stacked + m->nstacked;
+    if (!_dwm_stacking_holds(m, d, n)) {
+      if (n + 1 > _dwm_restack_capacity) {
+        _dwm_restack_capacity = MAX(n + 1, 2 * _dwm_restack_capacity);
+        _dwm_restack_windows = realloc(
+          _dwm_restack_windows, _dwm_restack_capacity * sizeof *_dwm_restack_windows);
+        if (!_dwm_restack_windows)
+          die("realloc:");
+      }
+      /* the bar stays, the clients go below it; with containers the bar is no
+       * sibling, the first client goes to the bottom of its container instead */
+      _dwm_restack_windows[0] = m->barwin;
+      for (i = 0; i < n; i++) {
+        _dwm_restack_windows[i + 1] = d[i]->win;
+        if (d[i]->win == m->raised)
+          m->raised = None; /* below the bar now, raised again when floating */
+      }
+      w = _dwm_restack_windows;
+      if (DWM_TAG_CONTAINERS && n)
+        XLowerWindow(dwm_x_display, *++w);
+      if (w + 1 < _dwm_restack_windows + n + 1)
+        XRestackWindows(dwm_x_display, w, _dwm_restack_windows + n + 1 - w);
+      for (i = 0; i < n; i++) {
+        m->stacked[i] = d[i];
+        m->stacked[i]->stackpos = i;
       }
+      m->nstacked = n;
+      sent = 1;
+    }
   }
-  XSync(dwm_x_display, False);
-  while (XCheckMaskEvent(dwm_x_display, EnterWindowMask, &ev))
-    ;
+  dwm_stats_end(&stats);
+  return sent;
 }
 
-void run(void) {
+static void _dwm_dispatch_batch() {
   XEvent ev;
-  /* main event loop */
-  XSync(dwm_x_display, False);
-  while (running && !XNextEvent(dwm_x_display, &ev))
-    if (drw_x_event_handlers[ev.type])
+  dwm_stats_scope_t stats;
+
+  while (running && dwm_next_batched_x_event(&ev))
+    if (drw_x_event_handlers[ev.type]) {
+      stats = dwm_stats_begin(ev.type);
       drw_x_event_handlers[ev.type](&ev); /* call handler */
+      dwm_stats_end(&stats);
+    }
+  _dwm_flush_scheduled();
+  /* input ends a batch, so the flush above is the action's */
+  if (_dwm_action_latency) {
+    dwm_histogram_add(_dwm_action_latency, dwm_stats_now_us() - _dwm_action_start_us);
+    _dwm_action_latency = NULL;
+  }
+}
+
+static void _dwm_handle_x_events(int fd, short revents, void* data) {
+  while (running && dwm_fill_x_event_batch())
+    _dwm_dispatch_batch();
+}
+
+void run(void) {
+  /* main event loop */
+  dwm_loop_add_fd(ConnectionNumber(dwm_x_display), POLLIN, _dwm_handle_x_events, NULL);
+  _dwm_flush_scheduled();
+  dwm_x_sync(False);
+  while (running) {
+    _dwm_handle_x_events(ConnectionNumber(dwm_x_display), POLLIN, NULL);
+    /* work scheduled by timers and signals */
+    _dwm_flush_scheduled();
+    XFlush(dwm_x_display);
+    /* a sync in the flush may have queued events poll(2) can't see anymore */
+    if (running && !XEventsQueued(dwm_x_display, QueuedAlready))
+      dwm_loop_poll();
+  }
+}
+
+/* root, systray and bars, in the order traces refer to them */
+static int _dwm_well_known_windows(Window* windows) {
+  int n = 0;
+
+  windows[n++] = dwm_x_window;
+  windows[n++] = dwm_get_systray_window();
+  for (dwm_monitor_t* m = dwm_screens; m && n < DWM_TRACE_MAX_WINDOWS; m = m->next)
+    windows[n++] = m->barwin;
+  return n;
+}
+
+/* Runs the handlers on a recorded trace instead of the X connection, as fast
+ * as possible. Events the server generates meanwhile are not part of the
+ * workload and dropped. */
+static void _dwm_replay(const char* path, int loops) {
+  XEvent ev;
+  Window windows[DWM_TRACE_MAX_WINDOWS];
+  unsigned long start, batches = 0, events = 0;
+  int n;
+
+  if (!dwm_trace_open(path, windows, _dwm_well_known_windows(windows)))
+    die("dwm: cannot replay %s", path);
+  replaying = 1;
+  start = dwm_stats_now_us();
+  for (int i = 0; running && i < loops; ++i) {
+    dwm_trace_rewind();
+    while (running && !dwm_trace_done()) {
+      if ((n = dwm_fill_event_batch(dwm_trace_next))) {
+        _dwm_dispatch_batch();
+        events += n;
+        ++batches;
+      }
+      while (XPending(dwm_x_display))
+        XNextEvent(dwm_x_display, &ev);
+    }
+  }
+  dwm_x_sync(False);
+  printf("dwm: replay loops %d batches %lu events %lu us %lu\n",
+         loops,
+         batches,
+         events,
+         dwm_stats_now_us() - start);
+  dwm_trace_close();
+  replaying = 0;
 }
 
 void scan(void) {
@@ -1402,7 +2069,7 @@ void sendmon(dwm_client_t* c, dwm_monitor_t* m) {
   _dwm_attach_client_to_monitor(c);
   _dwm_attach_stack(c);
   _dwm_focus_client(NULL);
-  _dwm_arrange_clients(NULL);
+  _dwm_schedule(NULL, DwmDirtyArrange);
 }
 
 void setfullscreen(dwm_client_t* c, int fullscreen) {
@@ -1420,8 +2087,10 @@ void setfullscreen(dwm_client_t* c, int fullscreen) {
     c->oldbw = c->bw;
     c->bw = 0;
     c->isfloating = 1;
+    _dwm_invalidate_tiled(c->mon);
     resizeclient(c, c->mon->mx, c->mon->my, c->mon->mw, c->mon->mh);
     XRaiseWindow(dwm_x_display, c->win);
+    _dwm_invalidate_stacking(c->mon);
   } else if (!fullscreen && c->isfullscreen) {
     XChangeProperty(dwm_x_display,
                     c->win,
@@ -1433,28 +2102,34 @@ void setfullscreen(dwm_client_t* c, int fullscreen) {
                     0);
     c->isfullscreen = 0;
     c->isfloating = c->oldstate;
+    _dwm_invalidate_tiled(c->mon);
     c->bw = c->oldbw;
     c->x = c->oldx;
     c->y = c->oldy;
     c->w = c->oldw;
     c->h = c->oldh;
     resizeclient(c, c->x, c->y, c->w, c->h);
-    _dwm_arrange_clients(c->mon);
+    _dwm_invalidate_stacking(c->mon);
+    _dwm_schedule(c->mon, DwmDirtyArrange);
   }
 }
 
 void setlayout(const Arg* arg) {
+  dwm_pertag_t* pertag = dwm_this_monitor->pertag;
+
   if (!arg || !arg->v || arg->v != dwm_this_monitor->lt[dwm_this_monitor->sellt])
-    dwm_this_monitor->sellt ^= 1;
+    pertag->sellts[pertag->curtag] = dwm_this_monitor->sellt ^= 1;
   if (arg && arg->v)
-    dwm_this_monitor->lt[dwm_this_monitor->sellt] = (dwm_layout_t*)arg->v;
+    pertag->ltidxs[pertag->curtag][dwm_this_monitor->sellt]
+      = dwm_this_monitor->lt[dwm_this_monitor->sellt] = (dwm_layout_t*)arg->v;
   strncpy(dwm_this_monitor->ltsymbol,
           dwm_this_monitor->lt[dwm_this_monitor->sellt]->symbol,
           sizeof dwm_this_monitor->ltsymbol);
+  _dwm_invalidate_stacking(dwm_this_monitor);
   if (dwm_this_monitor->sel)
-    _dwm_arrange_clients(dwm_this_monitor);
+    _dwm_schedule(dwm_this_monitor, DwmDirtyArrange);
   else
-    drawbar(dwm_this_monitor);
+    _dwm_schedule(dwm_this_monitor, DwmDirtyBar);
 }
 
 /* arg > 1.0 will set mfact absolutely */
@@ -1466,16 +2141,20 @@ void setmfact(const Arg* arg) {
   f = arg->f < 1.0 ? arg->f + dwm_this_monitor->mfact : arg->f - 1.0;
   if (f < 0.1 || f > 0.9)
     return;
-  dwm_this_monitor->mfact = f;
-  _dwm_arrange_clients(dwm_this_monitor);
+  dwm_this_monitor->mfact
+    = dwm_this_monitor->pertag->mfacts[dwm_this_monitor->pertag->curtag] = f;
+  _dwm_schedule(dwm_this_monitor, DwmDirtyArrange);
 }
 
 void spawn(const Arg* arg) {
+  if (replaying)
+    return;
   if (arg->v == dmenucmd)
     dmenumon[0] = '0' + dwm_this_monitor->num;
   if (fork() == 0) {
     if (dwm_x_display)
       close(ConnectionNumber(dwm_x_display));
+    dwm_loop_restore_signals();
     setsid();
     execvp(((char**)arg->v)[0], (char**)arg->v);
     fprintf(stderr, "dwm: execvp %s", ((char**)arg->v)[0]);
@@ -1486,9 +2165,9 @@ void spawn(const Arg* arg) {
 
 void tag(const Arg* arg) {
   if (dwm_this_monitor->sel && arg->ui & TAGMASK) {
-    dwm_this_monitor->sel->tags = arg->ui & TAGMASK;
+    _dwm_set_client_tags(dwm_this_monitor->sel, arg->ui & TAGMASK);
     _dwm_focus_client(NULL);
-    _dwm_arrange_clients(dwm_this_monitor);
+    _dwm_schedule(dwm_this_monitor, DwmDirtyArrange);
   }
 }
 
@@ -1498,37 +2177,28 @@ void tagmon(const Arg* arg) {
   sendmon(dwm_this_monitor->sel, _dwm_dir_to_monitor(arg->i));
 }
 
-void tile(dwm_monitor_t* m) {
-  unsigned int i, n, h, mw, my, ty;
-  dwm_client_t* c;
+void tile(dwm_monitor_t* m) { _dwm_arrange_tiled(m, dwm_layout_tile); }
 
-  for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++)
-    ;
-  if (n == 0)
-    return;
+void grid(dwm_monitor_t* m) { _dwm_arrange_tiled(m, dwm_layout_grid); }
 
-  if (n > m->nmaster)
-    mw = m->nmaster ? m->ww * m->mfact : 0;
-  else
-    mw = m->ww;
-  for (i = my = ty = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
-    if (i < m->nmaster) {
-      h = (m->wh - my) / (MIN(n, m->nmaster) - i);
-      resize(c, m->wx, m->wy + my, mw - (2 * c->bw), h - (2 * c->bw), 0);
-      my += HEIGHT(c);
-    } else {
-      h = (m->wh - ty) / (n - i);
-      resize(c, m->wx + mw, m->wy + ty, m->ww - mw - (2 * c->bw), h - (2 * c->bw), 0);
-      ty += HEIGHT(c);
-    }
+void bstack(dwm_monitor_t* m) { _dwm_arrange_tiled(m, dwm_layout_bstack); }
+
+void centeredmaster(dwm_monitor_t* m) {
+  _dwm_arrange_tiled(m, dwm_layout_centeredmaster);
 }
 
+void spiral(dwm_monitor_t* m) { _dwm_arrange_tiled(m, dwm_layout_spiral); }
+
+void dwindle(dwm_monitor_t* m) { _dwm_arrange_tiled(m, dwm_layout_dwindle); }
+
 void togglebar(const Arg* arg) {
-  dwm_this_monitor->showbar = !dwm_this_monitor->showbar;
+  dwm_this_monitor->showbar
+    = dwm_this_monitor->pertag->showbars[dwm_this_monitor->pertag->curtag]
+    = !dwm_this_monitor->showbar;
   updatebarpos(dwm_this_monitor);
   move_resize_bar(dwm_this_monitor);
   dwm_toggle_systray();
-  _dwm_arrange_clients(dwm_this_monitor);
+  _dwm_schedule(dwm_this_monitor, DwmDirtyArrange);
 }
 
 void togglefloating(const Arg* arg) {
@@ -1538,6 +2208,8 @@ void togglefloating(const Arg* arg) {
     return;
   dwm_this_monitor->sel->isfloating
     = !dwm_this_monitor->sel->isfloating || dwm_this_monitor->sel->isfixed;
+  _dwm_invalidate_tiled(dwm_this_monitor);
+  _dwm_invalidate_stacking(dwm_this_monitor);
   if (dwm_this_monitor->sel->isfloating)
     resize(dwm_this_monitor->sel,
            dwm_this_monitor->sel->x,
@@ -1545,7 +2217,7 @@ void togglefloating(const Arg* arg) {
            dwm_this_monitor->sel->w,
            dwm_this_monitor->sel->h,
            0);
-  _dwm_arrange_clients(dwm_this_monitor);
+  _dwm_schedule(dwm_this_monitor, DwmDirtyArrange);
 }
 
 void toggletag(const Arg* arg) {
@@ -1555,20 +2227,23 @@ void toggletag(const Arg* arg) {
     return;
   newtags = dwm_this_monitor->sel->tags ^ (arg->ui & TAGMASK);
   if (newtags) {
-    dwm_this_monitor->sel->tags = newtags;
+    _dwm_set_client_tags(dwm_this_monitor->sel, newtags);
     _dwm_focus_client(NULL);
-    _dwm_arrange_clients(dwm_this_monitor);
+    _dwm_schedule(dwm_this_monitor, DwmDirtyArrange);
   }
 }
 
 void toggleview(const Arg* arg) {
-  unsigned int newtagset
-    = dwm_this_monitor->tagset[dwm_this_monitor->seltags] ^ (arg->ui & TAGMASK);
+  unsigned int oldtagset = dwm_this_monitor->tagset[dwm_this_monitor->seltags];
+  unsigned int newtagset = oldtagset ^ (arg->ui & TAGMASK);
 
   if (newtagset) {
     dwm_this_monitor->tagset[dwm_this_monitor->seltags] = newtagset;
+    _dwm_invalidate_tiled(dwm_this_monitor);
+    _dwm_select_tag_state(_dwm_tag_slot(newtagset));
+    _dwm_update_tag_visibility(dwm_this_monitor, oldtagset);
     _dwm_focus_client(NULL);
-    _dwm_arrange_clients(dwm_this_monitor);
+    _dwm_schedule(dwm_this_monitor, DwmDirtyLayout | DwmDirtyStack);
   }
 }
 
@@ -1578,37 +2253,52 @@ void unmanage(dwm_client_t* c, int destroyed) {
 
   detach(c);
   _dwm_detach_stack(c);
+  dwm_winmap_remove(c->win);
+  if (m->raised == c->win)
+    m->raised = None;
   if (!destroyed) {
     wc.border_width = c->oldbw;
     // avoid race conditions
     XGrabServer(dwm_x_display);
     XSetErrorHandler(xerrordummy);
     XConfigureWindow(dwm_x_display, c->win, CWBorderWidth, &wc); /* restore border */
+    if (c->container) {
+      XReparentWindow(dwm_x_display, c->win, dwm_x_window, c->sx, c->sy);
+      XRemoveFromSaveSet(dwm_x_display, c->win);
+    }
     XUngrabButton(dwm_x_display, AnyButton, AnyModifier, c->win);
     dwm_set_x_window_state(c, WithdrawnState);
-    XSync(dwm_x_display, False);
+    dwm_x_sync(False);
     XSetErrorHandler(xerror);
     XUngrabServer(dwm_x_display);
   }
-  free(c);
+  dwm_title_release(c->title);
+  dwm_free_client(c);
   _dwm_focus_client(NULL);
-  updateclientlist();
-  _dwm_arrange_clients(m);
+  _dwm_schedule(NULL, DwmDirtyClientList);
+  _dwm_schedule(m, DwmDirtyArrange);
 }
 
 void unmapnotify(XEvent* e) {
   dwm_client_t* c;
   XUnmapEvent* ev = &e->xunmap;
+  dwm_win_t win = dwm_winmap_find(ev->window);
 
-  if ((c = wintoclient(ev->window))) {
-    if (ev->send_event)
+  if (win.kind == DwmWinClient) {
+    c = win.client;
+    /* unmapping a window dwm already unmapped generates no event, only the
+     * synthetic one of ICCCM 4.1.4 tells that the client withdrew it */
+    if (ev->send_event && c->isunmapped)
+      unmanage(c, 0);
+    else if (ev->send_event)
       dwm_set_x_window_state(c, WithdrawnState);
+    else if (c->ignoreunmap)
+      c->ignoreunmap--;
     else
       unmanage(c, 0);
-  } else if ((c = dwm_find_systray_icon_client(ev->window))) {
-    dwm_remove_systray_icon(c);
-    move_resize_bar(dwm_this_monitor);
-    dwm_update_systray();
+  } else if (win.kind == DwmWinTrayIcon) {
+    dwm_remove_systray_icon(win.client);
+    _dwm_schedule(dwm_this_monitor, DwmDirtyBar | DwmDirtySystray);
   }
 }
 
@@ -1636,6 +2326,7 @@ void updatebars(void) {
                               DefaultVisual(dwm_x_display, dwm_x_screen),
                               CWOverrideRedirect | CWBackPixmap | CWEventMask,
                               &wa);
+    dwm_winmap_insert(m->barwin, DwmWinBar, NULL, m);
     XDefineCursor(dwm_x_display, m->barwin, cursor[CurNormal]->cursor);
     dwm_raise_systray(m);
     XMapRaised(dwm_x_display, m->barwin);
@@ -1711,6 +2402,7 @@ int updategeom(void) {
           m->mw = m->ww = unique[i].width;
           m->mh = m->wh = unique[i].height;
           updatebarpos(m);
+          _dwm_update_containers(m);
         }
     } else { /* less monitors available nn < n */
       for (i = nn; i < n; i++) {
@@ -1740,6 +2432,7 @@ int updategeom(void) {
       dwm_screens->mw = dwm_screens->ww = dwm_x_screen_width;
       dwm_screens->mh = dwm_screens->wh = dwm_x_screen_height;
       updatebarpos(dwm_screens);
+      _dwm_update_containers(dwm_screens);
     }
   }
   if (dirty) {
@@ -1750,40 +2443,24 @@ int updategeom(void) {
 }
 
 void view(const Arg* arg) {
-  if ((arg->ui & TAGMASK) == dwm_this_monitor->tagset[dwm_this_monitor->seltags])
+  unsigned int oldtagset = dwm_this_monitor->tagset[dwm_this_monitor->seltags];
+
+  if ((arg->ui & TAGMASK) == oldtagset)
     return;
   dwm_this_monitor->seltags ^= 1; /* toggle sel tagset */
   if (arg->ui & TAGMASK)
     dwm_this_monitor->tagset[dwm_this_monitor->seltags] = arg->ui & TAGMASK;
+  _dwm_invalidate_tiled(dwm_this_monitor);
+  _dwm_select_tag_state(
+    _dwm_tag_slot(dwm_this_monitor->tagset[dwm_this_monitor->seltags]));
+  _dwm_update_tag_visibility(dwm_this_monitor, oldtagset);
   _dwm_focus_client(NULL);
-  _dwm_arrange_clients(dwm_this_monitor);
+  _dwm_schedule(dwm_this_monitor, DwmDirtyLayout | DwmDirtyStack);
 }
 
-dwm_client_t* wintoclient(Window w) {
-  dwm_client_t* c;
-  dwm_monitor_t* m;
-
-  for (m = dwm_screens; m; m = m->next)
-    for (c = m->clients; c; c = c->next)
-      if (c->win == w)
-        return c;
-  return NULL;
-}
-
-dwm_monitor_t* wintomon(Window w) {
-  int x, y;
-  dwm_client_t* c;
-  dwm_monitor_t* m;
+dwm_client_t* wintoclient(Window w) { return dwm_winmap_find_client(w, DwmWinClient); }
 
-  if (w == dwm_x_window && getrootptr(&x, &y))
-    return recttomon(x, y, 1, 1);
-  for (m = dwm_screens; m; m = m->next)
-    if (w == m->barwin)
-      return m;
-  if ((c = wintoclient(w)))
-    return c->mon;
-  return dwm_this_monitor;
-}
+dwm_monitor_t* wintomon(Window w) { return _dwm_win_to_monitor(w, dwm_winmap_find(w)); }
 
 /* Obtain a backtrace and print it to stdout. */
 void
@@ -1849,35 +2526,31 @@ void zoom(const Arg* arg) {
   if (!dwm_this_monitor->lt[dwm_this_monitor->sellt]->arrange
       || (dwm_this_monitor->sel && dwm_this_monitor->sel->isfloating))
     return;
-  if (c == nexttiled(dwm_this_monitor->clients))
-    if (!c || !(c = nexttiled(c->next)))
+  if (!c)
+    return;
+  _dwm_update_tiled(dwm_this_monitor);
+  if (dwm_this_monitor->ntiled && c == dwm_this_monitor->tiled[0]) {
+    if (dwm_this_monitor->ntiled < 2)
       return;
+    c = dwm_this_monitor->tiled[1];
+  }
   pop(c);
 }
 
 void dwm_move_tiled_client(const Arg* arg) {
+  dwm_monitor_t* m = dwm_this_monitor;
   dwm_client_t *c = NULL, *p = NULL, *pc = NULL, *i;
+  unsigned int k;
 
-  if (arg->i > 0) {
-    /* find the client after dwm_this_monitor->sel */
-    for (c = dwm_this_monitor->sel->next; c && (!ISVISIBLE(c) || c->isfloating);
-         c = c->next)
-      ;
-    if (!c)
-      for (c = dwm_this_monitor->clients; c && (!ISVISIBLE(c) || c->isfloating);
-           c = c->next)
-        ;
-
-  } else {
-    /* find the client before dwm_this_monitor->sel */
-    for (i = dwm_this_monitor->clients; i != dwm_this_monitor->sel; i = i->next)
-      if (ISVISIBLE(i) && !i->isfloating)
-        c = i;
-    if (!c)
-      for (; i; i = i->next)
-        if (ISVISIBLE(i) && !i->isfloating)
-          c = i;
-  }
+  if (!m->sel)
+    return;
+  _dwm_update_tiled(m);
+  for (k = 0; k < m->ntiled && m->tiled[k] != m->sel; k++)
+    ;
+  if (k == m->ntiled)
+    return; /* floating, not part of the tiled order */
+  /* the tiled client after or before dwm_this_monitor->sel, wrapping around */
+  c = m->tiled[(arg->i > 0 ? k + 1 : k + m->ntiled - 1) % m->ntiled];
   /* find the client before dwm_this_monitor->sel and c */
   for (i = dwm_this_monitor->clients; i && (!p || !pc); i = i->next) {
     if (i->next == dwm_this_monitor->sel)
@@ -1903,7 +2576,8 @@ void dwm_move_tiled_client(const Arg* arg) {
     else if (c == dwm_this_monitor->clients)
       dwm_this_monitor->clients = dwm_this_monitor->sel;
 
-    _dwm_arrange_clients(dwm_this_monitor);
+    _dwm_invalidate_tiled(dwm_this_monitor);
+    _dwm_schedule(dwm_this_monitor, DwmDirtyArrange);
   }
 }
 
@@ -1912,22 +2586,25 @@ void dwm_toggle_scratch_pad(const Arg* arg) {
     return;
 
   if (dwm_this_monitor->scratchpad) {
-    unsigned int newtagset
-      = dwm_this_monitor->tagset[dwm_this_monitor->seltags] ^ scratchtag;
+    unsigned int oldtagset = dwm_this_monitor->tagset[dwm_this_monitor->seltags];
+    unsigned int newtagset = oldtagset ^ scratchtag;
     if (newtagset) {
       dwm_this_monitor->tagset[dwm_this_monitor->seltags] = newtagset;
+      _dwm_invalidate_tiled(dwm_this_monitor);
+      _dwm_update_tag_visibility(dwm_this_monitor, oldtagset);
       _dwm_focus_client(NULL);
-      _dwm_arrange_clients(dwm_this_monitor);
+      _dwm_schedule(dwm_this_monitor, DwmDirtyLayout | DwmDirtyStack);
     }
     if (ISVISIBLE(dwm_this_monitor->scratchpad)) {
       _dwm_focus_client(dwm_this_monitor->scratchpad);
-      restack(dwm_this_monitor);
+      _dwm_schedule(dwm_this_monitor, DwmDirtyStack);
     }
-  } else {
+  } else if (!replaying) {
     __pid_t pid = fork();
     if (pid == 0) {
       if (dwm_x_display)
         close(ConnectionNumber(dwm_x_display));
+      dwm_loop_restore_signals();
       setsid();
       execvp(((char**)arg->v)[0], (char**)arg->v);
       fprintf(stderr, "dwm: execvp %s", ((char**)arg->v)[0]);
@@ -1978,25 +2655,99 @@ static void _dwm_check_other_window_manager(void) {
   xerrorxlib = XSetErrorHandler(xerrorstart);
   /* this causes an error if some other window manager is running */
   XSelectInput(dwm_x_display, DefaultRootWindow(dwm_x_display), SubstructureRedirectMask);
-  XSync(dwm_x_display, False);
+  dwm_x_sync(False);
   XSetErrorHandler(xerror);
-  XSync(dwm_x_display, False);
+  dwm_x_sync(False);
 }
 
+/* signal handlers run from the main loop, not in signal context */
 static void _dwm_sigchld(int unused) {
-  if (signal(SIGCHLD, _dwm_sigchld) == SIG_ERR)
-    die("can't install SIGCHLD handler:");
   while (0 < waitpid(-1, NULL, WNOHANG))
     ;
 }
 
+static void _dwm_sigterm(int unused) { running = 0; }
+
+static void _dwm_sigusr1(int unused) {
+  char name[64];
+  const char* keysym;
+
+  fprintf(stderr, "dwm: %lu round trips through XSync\n", dwm_x_sync_count);
+  dwm_stats_dump(stderr);
+  for (unsigned int i = 0; i < LENGTH(keys); ++i) {
+    keysym = XKeysymToString(keys[i].keysym);
+    snprintf(name, sizeof name, "key:0x%x:%s", keys[i].mod, keysym ? keysym : "?");
+    dwm_histogram_dump(stderr, name, &_dwm_key_latency[i]);
+  }
+  for (unsigned int i = 0; i < LENGTH(buttons); ++i) {
+    snprintf(name,
+             sizeof name,
+             "button:%u:0x%x:%u",
+             buttons[i].click,
+             buttons[i].mask,
+             buttons[i].button);
+    dwm_histogram_dump(stderr, name, &_dwm_button_latency[i]);
+  }
+}
+
+/* interns every atom in a single round trip */
+static void _dwm_intern_atoms() {
+  static const char* wm_names[_WMLast] = {
+    [WMProtocols] = "WM_PROTOCOLS",
+    [WMDelete] = "WM_DELETE_WINDOW",
+    [WMState] = "WM_STATE",
+    [WMTakeFocus] = "WM_TAKE_FOCUS",
+  };
+  static const char* net_names[_NetLast] = {
+    [NetSupported] = "_NET_SUPPORTED",
+    [NetSystemTray] = "_NET_SYSTEM_TRAY_S0",
+    [NetSystemTrayOP] = "_NET_SYSTEM_TRAY_OPCODE",
+    [NetSystemTrayOrientation] = "_NET_SYSTEM_TRAY_ORIENTATION",
+    [NetWMName] = "_NET_WM_NAME",
+    [NetWMState] = "_NET_WM_STATE",
+    [NetWMCheck] = "_NET_SUPPORTING_WM_CHECK",
+    [NetWMFullscreen] = "_NET_WM_STATE_FULLSCREEN",
+    [NetActiveWindow] = "_NET_ACTIVE_WINDOW",
+    [NetWMWindowType] = "_NET_WM_WINDOW_TYPE",
+    [NetWMWindowTypeDialog] = "_NET_WM_WINDOW_TYPE_DIALOG",
+    [NetClientList] = "_NET_CLIENT_LIST",
+    /* https://specifications.freedesktop.org/wm-spec/wm-spec-latest.html#idm140200472565744 */
+    [NetWMPid] = "_NET_WM_PID",
+  };
+  static const char* x_names[_XLast] = {
+    [Manager] = "MANAGER",
+    [Xembed] = "_XEMBED",
+    [XembedInfo] = "_XEMBED_INFO",
+    [Utf8String] = "UTF8_STRING",
+  };
+  char* names[_WMLast + _NetLast + _XLast];
+  Atom atoms[_WMLast + _NetLast + _XLast];
+  int n = 0;
+
+  for (int i = 0; i < _WMLast; ++i)
+    names[n++] = (char*)wm_names[i];
+  for (int i = 0; i < _NetLast; ++i)
+    names[n++] = (char*)net_names[i];
+  for (int i = 0; i < _XLast; ++i)
+    names[n++] = (char*)x_names[i];
+  if (!XInternAtoms(dwm_x_display, names, n, False, atoms))
+    die("dwm: cannot intern atoms");
+  memcpy(dwm_x_wm_atoms, atoms, sizeof dwm_x_wm_atoms);
+  memcpy(dwm_x_net_atoms, atoms + _WMLast, sizeof dwm_x_net_atoms);
+  memcpy(dwm_x_atoms, atoms + _WMLast + _NetLast, sizeof dwm_x_atoms);
+}
+
 static void _dwm_setup() {
   int i;
   XSetWindowAttributes wa;
-  Atom utf8string;
 
+  dwm_loop_init();
+  dwm_loop_on_signal(SIGCHLD, _dwm_sigchld);
+  dwm_loop_on_signal(SIGTERM, _dwm_sigterm);
+  dwm_loop_on_signal(SIGUSR1, _dwm_sigusr1);
   // clean up any zombies immediately
   _dwm_sigchld(0);
+  dwm_stats_init();
 
   // init screen
   dwm_x_screen = DefaultScreen(dwm_x_display);
@@ -2014,35 +2765,7 @@ static void _dwm_setup() {
   lrpad = dwm_drw->fonts->h;
   dwm_bar_height = dwm_drw->fonts->h + 2;
   updategeom();
-  // init atoms
-  utf8string = XInternAtom(dwm_x_display, "UTF8_STRING", False);
-  dwm_x_wm_atoms[WMProtocols] = XInternAtom(dwm_x_display, "WM_PROTOCOLS", False);
-  dwm_x_wm_atoms[WMDelete] = XInternAtom(dwm_x_display, "WM_DELETE_WINDOW", False);
-  dwm_x_wm_atoms[WMState] = XInternAtom(dwm_x_display, "WM_STATE", False);
-  dwm_x_wm_atoms[WMTakeFocus] = XInternAtom(dwm_x_display, "WM_TAKE_FOCUS", False);
-  dwm_x_net_atoms[NetActiveWindow]
-    = XInternAtom(dwm_x_display, "_NET_ACTIVE_WINDOW", False);
-  dwm_x_net_atoms[NetSupported] = XInternAtom(dwm_x_display, "_NET_SUPPORTED", False);
-  dwm_x_net_atoms[NetSystemTray]
-    = XInternAtom(dwm_x_display, "_NET_SYSTEM_TRAY_S0", False);
-  dwm_x_net_atoms[NetSystemTrayOP]
-    = XInternAtom(dwm_x_display, "_NET_SYSTEM_TRAY_OPCODE", False);
-  dwm_x_net_atoms[NetSystemTrayOrientation]
-    = XInternAtom(dwm_x_display, "_NET_SYSTEM_TRAY_ORIENTATION", False);
-  dwm_x_net_atoms[NetWMName] = XInternAtom(dwm_x_display, "_NET_WM_NAME", False);
-  dwm_x_net_atoms[NetWMState] = XInternAtom(dwm_x_display, "_NET_WM_STATE", False);
-  dwm_x_net_atoms[NetWMCheck]
-    = XInternAtom(dwm_x_display, "_NET_SUPPORTING_WM_CHECK", False);
-  dwm_x_net_atoms[NetWMFullscreen]
-    = XInternAtom(dwm_x_display, "_NET_WM_STATE_FULLSCREEN", False);
-  dwm_x_net_atoms[NetWMWindowType]
-    = XInternAtom(dwm_x_display, "_NET_WM_WINDOW_TYPE", False);
-  dwm_x_net_atoms[NetWMWindowTypeDialog]
-    = XInternAtom(dwm_x_display, "_NET_WM_WINDOW_TYPE_DIALOG", False);
-  dwm_x_net_atoms[NetClientList] = XInternAtom(dwm_x_display, "_NET_CLIENT_LIST", False);
-  dwm_x_atoms[Manager] = XInternAtom(dwm_x_display, "MANAGER", False);
-  dwm_x_atoms[Xembed] = XInternAtom(dwm_x_display, "_XEMBED", False);
-  dwm_x_atoms[XembedInfo] = XInternAtom(dwm_x_display, "_XEMBED_INFO", False);
+  _dwm_intern_atoms();
   /* init cursors */
   cursor[CurNormal] = dwm_drw_cur_create(dwm_drw, XC_left_ptr);
   cursor[CurResize] = dwm_drw_cur_create(dwm_drw, XC_sizing);
@@ -2053,12 +2776,12 @@ static void _dwm_setup() {
     dwm_color_schemes[i] = dwm_drw_scm_create(dwm_drw, colors[i], 3);
   /* init system tray */
   dwm_create_systray();
-  dwm_update_systray();
   /* init bars */
   updatebars();
-  drawbar(dwm_this_monitor);
+  _dwm_schedule(dwm_this_monitor, DwmDirtyBar | DwmDirtySystray);
   /* supporting window for NetWMCheck */
   wmcheckwin = XCreateSimpleWindow(dwm_x_display, dwm_x_window, 0, 0, 1, 1, 0, 0, 0);
+  dwm_winmap_insert(wmcheckwin, DwmWinCheck, NULL, NULL);
   XChangeProperty(dwm_x_display,
                   wmcheckwin,
                   dwm_x_net_atoms[NetWMCheck],
@@ -2070,7 +2793,7 @@ static void _dwm_setup() {
   XChangeProperty(dwm_x_display,
                   wmcheckwin,
                   dwm_x_net_atoms[NetWMName],
-                  utf8string,
+                  dwm_x_atoms[Utf8String],
                   8,
                   PropModeReplace,
                   (unsigned char*)"dwm",
@@ -2100,6 +2823,7 @@ static void _dwm_setup() {
     | PropertyChangeMask;
   XChangeWindowAttributes(dwm_x_display, dwm_x_window, CWEventMask | CWCursor, &wa);
   XSelectInput(dwm_x_display, dwm_x_window, wa.event_mask);
+  _dwm_update_num_lock_mask();
   _dwm_grab_keys();
   _dwm_focus_client(NULL);
 }
@@ -2108,9 +2832,20 @@ static void _dwm_clean_up() {
   Arg a = {.ui = ~0};
   dwm_layout_t foo = {"", NULL};
   dwm_monitor_t* m;
+  dwm_client_t* c;
   size_t i;
 
   view(&a);
+  _dwm_flush_scheduled(); /* bring hidden clients back before releasing them */
+  /* view() leaves the other monitors and the scratchpad hidden; unmapped they
+   * would end up withdrawn, which the next window manager doesn't adopt */
+  for (m = dwm_screens; m; m = m->next)
+    for (c = m->clients; c; c = c->next)
+      if (c->isunmapped) {
+        dwm_set_x_window_state(c, NormalState);
+        XMapWindow(dwm_x_display, c->win);
+        c->isunmapped = 0;
+      }
   dwm_this_monitor->lt[dwm_this_monitor->sellt] = &foo;
   for (m = dwm_screens; m; m = m->next)
     while (m->stack)
@@ -2124,31 +2859,62 @@ static void _dwm_clean_up() {
     dwm_drw_cur_free(dwm_drw, cursor[i]);
   for (i = 0; i < LENGTH(colors); i++)
     free(dwm_color_schemes[i]);
+  dwm_winmap_remove(wmcheckwin);
   XDestroyWindow(dwm_x_display, wmcheckwin);
   dwm_release_dwm_drw(dwm_drw);
-  XSync(dwm_x_display, False);
+  dwm_x_sync(False);
   XSetInputFocus(dwm_x_display, PointerRoot, RevertToPointerRoot, CurrentTime);
   XDeleteProperty(dwm_x_display, dwm_x_window, dwm_x_net_atoms[NetActiveWindow]);
+  dwm_loop_release();
+  dwm_winmap_release();
+  dwm_release_client_pool();
+  free(_dwm_hide_queue);
+  free(_dwm_layout_input);
+  free(_dwm_layout_rects);
+  free(_dwm_restack_windows);
+  dwm_title_release_all();
+  dwm_trace_stop_recording();
 }
 
 int main(int argc, char* argv[]) {
-  if (argc == 2 && !strcmp("-v", argv[1]))
-    die("dwm-" VERSION);
-  else if (argc != 1)
-    die("usage: dwm [-v]");
+  const char *record = NULL, *replay = NULL;
+  Window windows[DWM_TRACE_MAX_WINDOWS];
+  int loops = 1;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp("-v", argv[i]))
+      die("dwm-" VERSION);
+    else if (!strcmp("-record", argv[i]) && i + 1 < argc)
+      record = argv[++i];
+    else if (!strcmp("-replay", argv[i]) && i + 1 < argc)
+      replay = argv[++i];
+    else if (!strcmp("-loops", argv[i]) && i + 1 < argc)
+      loops = atoi(argv[++i]);
+    else
+      die("usage: dwm [-v] [-record file] [-replay file [-loops n]]");
+  }
   if (!setlocale(LC_CTYPE, "") || !XSupportsLocale())
     fputs("warning: no locale support\n", stderr);
   if (!(dwm_x_display = XOpenDisplay(NULL)))
     die("dwm: cannot open display");
   _dwm_check_other_window_manager();
   _dwm_setup();
+  /* the trace is created before pledge() takes away wpath and cpath */
+  if (record
+      && !dwm_trace_start_recording(record, windows, _dwm_well_known_windows(windows)))
+    die("dwm: cannot record to %s:", record);
 #ifdef __OpenBSD__
   if (pledge("stdio rpath proc exec", NULL) == -1)
     die("pledge");
 #endif /* __OpenBSD__ */
   scan();
-  startup();
-  run();
+  if (replay) {
+    _dwm_replay(replay, loops);
+    _dwm_sigusr1(SIGUSR1); /* the cost of the replayed handlers */
+  } else {
+    startup();
+    run();
+  }
   _dwm_clean_up();
   XCloseDisplay(dwm_x_display);
   return EXIT_SUCCESS;
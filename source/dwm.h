@@ -16,6 +16,15 @@ enum {
   ClkRootWin,
   _ClkLast
 }; /* clicks */
+enum {
+  DwmDirtyLayout = 1 << 0,
+  DwmDirtyStack = 1 << 1,
+  DwmDirtyBar = 1 << 2,
+  DwmDirtySystray = 1 << 3,
+  DwmDirtyClientList = 1 << 4,
+  DwmDirtyVisibility = 1 << 5,
+  DwmDirtyArrange = DwmDirtyLayout | DwmDirtyVisibility | DwmDirtyStack | DwmDirtyBar
+}; /* scheduled work */
 
 typedef union {
   int i;
@@ -57,7 +66,6 @@ static dwm_monitor_t* createmon(void);
 static void destroynotify(XEvent* e);
 static void detach(dwm_client_t* c);
 static void drawbar(dwm_monitor_t* m);
-static void drawbars(void);
 static void enternotify(XEvent* e);
 static void expose(XEvent* e);
 static void focusin(XEvent* e);
@@ -72,9 +80,13 @@ static void manage(Window w, XWindowAttributes* wa);
 static void mappingnotify(XEvent* e);
 static void maprequest(XEvent* e);
 static void monocle(dwm_monitor_t* m);
+static void grid(dwm_monitor_t* m);
+static void bstack(dwm_monitor_t* m);
+static void centeredmaster(dwm_monitor_t* m);
+static void spiral(dwm_monitor_t* m);
+static void dwindle(dwm_monitor_t* m);
 static void motionnotify(XEvent* e);
 static void movemouse(const Arg* arg);
-static dwm_client_t* nexttiled(dwm_client_t* c);
 static void pop(dwm_client_t*);
 static void propertynotify(XEvent* e);
 static void quit(const Arg* arg);
@@ -84,7 +96,7 @@ static void move_resize_bar(dwm_monitor_t* m);
 static void resize(dwm_client_t* c, int x, int y, int w, int h, int interact);
 static void resizeclient(dwm_client_t* c, int x, int y, int w, int h);
 static void resizemouse(const Arg* arg);
-static void restack(dwm_monitor_t* m);
+static int restack(dwm_monitor_t* m);
 static void run(void);
 static void scan(void);
 static void sendmon(dwm_client_t* c, dwm_monitor_t* m);
@@ -20,7 +20,6 @@ void dwm_updatenum_lock_mask_dwm_updatenum_lock_mask() {
 }
 
 int dwm_apply_size_hints(dwm_client_t* c, int* x, int* y, int* w, int* h, int interact) {
-  int baseismin;
   dwm_monitor_t* m = c->mon;
 
   /* set minimum possible */
@@ -49,37 +48,8 @@ int dwm_apply_size_hints(dwm_client_t* c, int* x, int* y, int* w, int* h, int in
     *h = dwm_bar_height;
   if (*w < dwm_bar_height)
     *w = dwm_bar_height;
-  if (DWM_RESIZE_HINTS || c->isfloating || !c->mon->lt[c->mon->sellt]->arrange) {
-    /* see last two sentences in ICCCM 4.1.2.3 */
-    baseismin = c->basew == c->minw && c->baseh == c->minh;
-    if (!baseismin) { /* temporarily remove base dimensions */
-      *w -= c->basew;
-      *h -= c->baseh;
-    }
-    /* adjust for aspect limits */
-    if (c->mina > 0 && c->maxa > 0) {
-      if (c->maxa < (float)*w / *h)
-        *w = *h * c->maxa + 0.5;
-      else if (c->mina < (float)*h / *w)
-        *h = *w * c->mina + 0.5;
-    }
-    if (baseismin) { /* increment calculation requires this */
-      *w -= c->basew;
-      *h -= c->baseh;
-    }
-    /* adjust for increment value */
-    if (c->incw)
-      *w -= *w % c->incw;
-    if (c->inch)
-      *h -= *h % c->inch;
-    /* restore base dimensions */
-    *w = MAX(*w + c->basew, c->minw);
-    *h = MAX(*h + c->baseh, c->minh);
-    if (c->maxw)
-      *w = MIN(*w, c->maxw);
-    if (c->maxh)
-      *h = MIN(*h, c->maxh);
-  }
+  if (DWM_RESIZE_HINTS || c->isfloating || !c->mon->lt[c->mon->sellt]->arrange)
+    dwm_size_hints_apply(&c->hints, w, h);
   return *x != c->x || *y != c->y || *w != c->w || *h != c->h;
 }
 
@@ -90,38 +60,47 @@ void dwm_update_size_hints(dwm_client_t* c) {
   if (!XGetWMNormalHints(dwm_x_display, c->win, &size, &msize))
     /* size is uninitialized, ensure that size.flags aren't used */
     size.flags = PSize;
+  dwm_set_size_hints(c, &size);
+}
+
+void dwm_set_size_hints(dwm_client_t* c, XSizeHints* hints) {
+  XSizeHints size = {.flags = PSize};
+
+  if (hints)
+    size = *hints;
   if (size.flags & PBaseSize) {
-    c->basew = size.base_width;
-    c->baseh = size.base_height;
+    c->hints.basew = size.base_width;
+    c->hints.baseh = size.base_height;
   } else if (size.flags & PMinSize) {
-    c->basew = size.min_width;
-    c->baseh = size.min_height;
+    c->hints.basew = size.min_width;
+    c->hints.baseh = size.min_height;
   } else
-    c->basew = c->baseh = 0;
+    c->hints.basew = c->hints.baseh = 0;
   if (size.flags & PResizeInc) {
-    c->incw = size.width_inc;
-    c->inch = size.height_inc;
+    c->hints.incw = size.width_inc;
+    c->hints.inch = size.height_inc;
   } else
-    c->incw = c->inch = 0;
+    c->hints.incw = c->hints.inch = 0;
   if (size.flags & PMaxSize) {
-    c->maxw = size.max_width;
-    c->maxh = size.max_height;
+    c->hints.maxw = size.max_width;
+    c->hints.maxh = size.max_height;
   } else
-    c->maxw = c->maxh = 0;
+    c->hints.maxw = c->hints.maxh = 0;
   if (size.flags & PMinSize) {
-    c->minw = size.min_width;
-    c->minh = size.min_height;
+    c->hints.minw = size.min_width;
+    c->hints.minh = size.min_height;
   } else if (size.flags & PBaseSize) {
-    c->minw = size.base_width;
-    c->minh = size.base_height;
+    c->hints.minw = size.base_width;
+    c->hints.minh = size.base_height;
   } else
-    c->minw = c->minh = 0;
+    c->hints.minw = c->hints.minh = 0;
   if (size.flags & PAspect) {
-    c->mina = (float)size.min_aspect.y / size.min_aspect.x;
-    c->maxa = (float)size.max_aspect.x / size.max_aspect.y;
+    c->hints.mina = (float)size.min_aspect.y / size.min_aspect.x;
+    c->hints.maxa = (float)size.max_aspect.x / size.max_aspect.y;
   } else
-    c->maxa = c->mina = 0.0;
-  c->isfixed = (c->maxw && c->maxh && c->maxw == c->minw && c->maxh == c->minh);
+    c->hints.maxa = c->hints.mina = 0.0;
+  c->isfixed = (c->hints.maxw && c->hints.maxh && c->hints.maxw == c->hints.minw
+                && c->hints.maxh == c->hints.minh);
 }
 
 Atom dwm_get_x_atom_property(dwm_client_t* c, Atom prop) {
@@ -147,12 +126,27 @@ Atom dwm_get_x_atom_property(dwm_client_t* c, Atom prop) {
   return atom;
 }
 
+static void _send_client_message(
+  Window w, Atom mt, int mask, long d0, long d1, long d2, long d3, long d4) {
+  XEvent ev;
+
+  ev.type = ClientMessage;
+  ev.xclient.window = w;
+  ev.xclient.message_type = mt;
+  ev.xclient.format = 32;
+  ev.xclient.data.l[0] = d0;
+  ev.xclient.data.l[1] = d1;
+  ev.xclient.data.l[2] = d2;
+  ev.xclient.data.l[3] = d3;
+  ev.xclient.data.l[4] = d4;
+  XSendEvent(dwm_x_display, w, False, mask, &ev);
+}
+
 int dwm_send_x_event(
   Window w, Atom proto, int mask, long d0, long d1, long d2, long d3, long d4) {
   int n;
   Atom *protocols, mt;
   int exists = 0;
-  XEvent ev;
 
   if (proto == dwm_x_wm_atoms[WMTakeFocus] || proto == dwm_x_wm_atoms[WMDelete]) {
     mt = dwm_x_wm_atoms[WMProtocols];
@@ -165,21 +159,70 @@ int dwm_send_x_event(
     exists = True;
     mt = proto;
   }
-  if (exists) {
-    ev.type = ClientMessage;
-    ev.xclient.window = w;
-    ev.xclient.message_type = mt;
-    ev.xclient.format = 32;
-    ev.xclient.data.l[0] = d0;
-    ev.xclient.data.l[1] = d1;
-    ev.xclient.data.l[2] = d2;
-    ev.xclient.data.l[3] = d3;
-    ev.xclient.data.l[4] = d4;
-    XSendEvent(dwm_x_display, w, False, mask, &ev);
-  }
+  if (exists)
+    _send_client_message(w, mt, mask, d0, d1, d2, d3, d4);
   return exists;
 }
 
+static unsigned int _protocol_bit(Atom proto) {
+  if (proto == dwm_x_wm_atoms[WMDelete])
+    return DwmProtoDelete;
+  if (proto == dwm_x_wm_atoms[WMTakeFocus])
+    return DwmProtoTakeFocus;
+  return 0;
+}
+
+void dwm_update_wm_protocols(dwm_client_t* c) {
+  int n;
+  Atom* protocols;
+
+  c->protocols = 0;
+  if (XGetWMProtocols(dwm_x_display, c->win, &protocols, &n)) {
+    while (n--)
+      c->protocols |= _protocol_bit(protocols[n]);
+    XFree(protocols);
+  }
+}
+
+int dwm_send_wm_protocol(dwm_client_t* c, Atom proto) {
+  if (!(c->protocols & _protocol_bit(proto)))
+    return 0;
+  _send_client_message(
+    c->win, dwm_x_wm_atoms[WMProtocols], NoEventMask, proto, CurrentTime, 0, 0, 0);
+  return 1;
+}
+
+void dwm_invalidate_client_property(dwm_client_t* c, Atom atom) {
+  if (atom == dwm_x_net_atoms[NetWMState])
+    c->stale |= DwmStaleState;
+}
+
+void dwm_drop_client_property(dwm_client_t* c, Atom atom) {
+  if (atom == XA_WM_HINTS)
+    c->haswmhints = 0;
+  else if (atom == XA_WM_NORMAL_HINTS)
+    dwm_set_size_hints(c, NULL);
+  else if (atom == dwm_x_wm_atoms[WMProtocols])
+    c->protocols = 0;
+  else if (atom == dwm_x_net_atoms[NetWMState]) {
+    c->winstate = None;
+    c->stale &= ~DwmStaleState;
+  }
+}
+
+Atom dwm_get_client_state(dwm_client_t* c) {
+  if (c->stale & DwmStaleState) {
+    c->winstate = dwm_get_x_atom_property(c, dwm_x_net_atoms[NetWMState]);
+    c->stale &= ~DwmStaleState;
+  }
+  return c->winstate;
+}
+
+void dwm_x_sync(Bool discard) {
+  ++dwm_x_sync_count;
+  XSync(dwm_x_display, discard);
+}
+
 void dwm_set_x_window_state(dwm_client_t* c, long state) {
   long data[] = {state, None};
 
@@ -3,14 +3,39 @@
 #include "dwm_global.h"
 
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
 
 int dwm_apply_size_hints(dwm_client_t* c, int* x, int* y, int* w, int* h, int interact);
 
 void dwm_update_size_hints(dwm_client_t* c);
 
+// hints NULL means the client has no WM_NORMAL_HINTS
+void dwm_set_size_hints(dwm_client_t* c, XSizeHints* hints);
+
 Atom dwm_get_x_atom_property(dwm_client_t* c, Atom prop);
 
 int dwm_send_x_event(
   Window w, Atom proto, int mask, long d0, long d1, long d2, long d3, long d4);
 
+// refreshes the WM_PROTOCOLS dwm cares about in c->protocols
+void dwm_update_wm_protocols(dwm_client_t* c);
+
+// sends WM_PROTOCOLS proto if the client supports it, without a round trip
+int dwm_send_wm_protocol(dwm_client_t* c, Atom proto);
+
+// Marks the cached property for atom as stale, it is fetched again on the next
+// read. Properties dwm reacts to right away are refetched by propertynotify().
+void dwm_invalidate_client_property(dwm_client_t* c, Atom atom);
+
+// Forgets the cached property for atom after the client deleted it, so it is
+// not written back, e.g. WM_HINTS by dwm_set_urgent().
+void dwm_drop_client_property(dwm_client_t* c, Atom atom);
+
+// first atom of _NET_WM_STATE
+Atom dwm_get_client_state(dwm_client_t* c);
+
 void dwm_set_x_window_state(dwm_client_t* c, long state);
+
+// XSync() which is accounted in dwm_x_sync_count. Requests are otherwise only
+// flushed once per event batch, so every call here is a deliberate round trip.
+void dwm_x_sync(Bool discard);
@@ -0,0 +1,167 @@
+#include "dwm_event.h"
+
+#include "../def_config.h"
+#include "dwm_global.h"
+#include "dwm_trace.h"
+
+static XEvent _batch[DWM_EVENT_BATCH_SIZE];
+static char _batch_alive[DWM_EVENT_BATCH_SIZE];
+static int _batch_count;
+static int _batch_cursor;
+
+/* the window an event is about, which is not always xany.window */
+static Window _event_window(const XEvent* e) {
+  switch (e->type) {
+  case ConfigureRequest:
+    return e->xconfigurerequest.window;
+  case DestroyNotify:
+    return e->xdestroywindow.window;
+  case UnmapNotify:
+    return e->xunmap.window;
+  case MapNotify:
+    return e->xmap.window;
+  case MapRequest:
+    return e->xmaprequest.window;
+  case ReparentNotify:
+    return e->xreparent.window;
+  case CreateNotify:
+    return e->xcreatewindow.window;
+  default:
+    return e->xany.window;
+  }
+}
+
+/* events which change the life cycle of a window, nothing is merged across them */
+static int _is_barrier(const XEvent* e) {
+  switch (e->type) {
+  case CreateNotify:
+  case DestroyNotify:
+  case UnmapNotify:
+  case MapNotify:
+  case MapRequest:
+  case ReparentNotify:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+/* user input is dispatched last in a batch, so that handlers running their own
+ * event loops (movemouse, resizemouse) never see events newer than the batch */
+static int _is_input(const XEvent* e) {
+  return e->type == KeyPress || e->type == ButtonPress;
+}
+
+static int _supersedes(const XEvent* e, const XEvent* older) {
+  if (e->type != older->type || _event_window(e) != _event_window(older))
+    return 0;
+  switch (e->type) {
+  case PropertyNotify:
+    return e->xproperty.atom == older->xproperty.atom;
+  case Expose:
+  case MotionNotify:
+  case ConfigureRequest:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+static void _merge_configure_request(XConfigureRequestEvent* e,
+                                     const XConfigureRequestEvent* older) {
+  unsigned long missing = older->value_mask & ~e->value_mask;
+
+  if (missing & CWX)
+    e->x = older->x;
+  if (missing & CWY)
+    e->y = older->y;
+  if (missing & CWWidth)
+    e->width = older->width;
+  if (missing & CWHeight)
+    e->height = older->height;
+  if (missing & CWBorderWidth)
+    e->border_width = older->border_width;
+  if (missing & CWSibling)
+    e->above = older->above;
+  if (missing & CWStackMode)
+    e->detail = older->detail;
+  e->value_mask |= older->value_mask;
+}
+
+/* Collapses the event at index i with the latest older event it supersedes.
+ * The newer event keeps its position, the older one is dropped. */
+static void _coalesce(int i) {
+  XEvent* e = &_batch[i];
+  Window w = _event_window(e);
+
+  if (e->type != PropertyNotify && e->type != Expose && e->type != MotionNotify
+      && e->type != ConfigureRequest)
+    return;
+  for (int j = i - 1; j >= 0; --j) {
+    if (!_batch_alive[j])
+      continue;
+    if (_is_barrier(&_batch[j]) && _event_window(&_batch[j]) == w)
+      return;
+    if (!_supersedes(e, &_batch[j]))
+      continue;
+    if (e->type == ConfigureRequest)
+      _merge_configure_request(&e->xconfigurerequest, &_batch[j].xconfigurerequest);
+    else if (e->type == Expose)
+      e->xexpose.count = 0; /* a single redraw covers all damage */
+    _batch_alive[j] = 0;
+    return;
+  }
+}
+
+static int _next_x_event(XEvent* ev) {
+  if (!XPending(dwm_x_display))
+    return 0;
+  XNextEvent(dwm_x_display, ev);
+  dwm_trace_record(ev);
+  return 1;
+}
+
+int dwm_fill_x_event_batch() {
+  int n = dwm_fill_event_batch(_next_x_event);
+
+  if (n)
+    dwm_trace_record_batch_end();
+  return n;
+}
+
+int dwm_fill_event_batch(dwm_event_source_t next) {
+  int n = 0;
+
+  _batch_count = _batch_cursor = 0;
+  if (!next(&_batch[0]))
+    return 0;
+  _batch_alive[_batch_count++] = 1;
+  if (_is_input(&_batch[0]))
+    return 1;
+  while (_batch_count < DWM_EVENT_BATCH_SIZE && next(&_batch[_batch_count])) {
+    _batch_alive[_batch_count] = 1;
+    _coalesce(_batch_count);
+    if (_is_input(&_batch[_batch_count++]))
+      break;
+  }
+  for (int i = 0; i < _batch_count; ++i)
+    n += _batch_alive[i];
+  return n;
+}
+
+int dwm_next_batched_x_event(XEvent* ev) {
+  while (_batch_cursor < _batch_count) {
+    int i = _batch_cursor++;
+    if (_batch_alive[i]) {
+      *ev = _batch[i];
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void dwm_discard_batched_x_events(int type) {
+  for (int i = _batch_cursor; i < _batch_count; ++i)
+    if (_batch[i].type == type)
+      _batch_alive[i] = 0;
+}
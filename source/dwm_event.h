@@ -0,0 +1,22 @@
+#pragma once
+
+#include <X11/Xlib.h>
+
+// Stores the next event in ev, returns 0 if there is none for now.
+typedef int (*dwm_event_source_t)(XEvent* ev);
+
+// Drains everything the server has already sent into the batch and collapses
+// redundant events. Never blocks; returns the number of events left to
+// dispatch, 0 if nothing was pending.
+int dwm_fill_x_event_batch();
+
+// Same for events from another source, e.g. a recorded trace.
+int dwm_fill_event_batch(dwm_event_source_t next);
+
+// Pops the next event of the current batch in arrival order. Returns 0 when
+// the batch is exhausted.
+int dwm_next_batched_x_event(XEvent* ev);
+
+// Drops all not yet dispatched events of the given type from the current
+// batch, e.g. EnterNotify events made stale by a restack.
+void dwm_discard_batched_x_events(int type);
@@ -18,3 +18,5 @@ XftColor** dwm_color_schemes = {0};
 Atom dwm_x_wm_atoms[_WMLast] = {0};
 Atom dwm_x_net_atoms[_NetLast] = {0};
 Atom dwm_x_atoms[_XLast] = {0};
+unsigned long dwm_x_sync_count = 0;
+unsigned int dwm_num_lock_mask = 0;
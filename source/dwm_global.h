@@ -2,6 +2,9 @@
 
 #include <X11/Xft/Xft.h>
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include "dwm_layout.h"
 
 #define WIDTH(X) ((X)->w + 2 * (X)->bw)
 #define HEIGHT(X) ((X)->h + 2 * (X)->bw)
@@ -12,19 +15,35 @@ typedef struct dwm_monitor_s dwm_monitor_t;
 
 typedef struct dwm_client_s dwm_client_t;
 
+typedef struct dwm_pertag_s dwm_pertag_t;
+
 typedef struct dwm_client_s {
-  char name[256];
-  float mina, maxa;
-  int x, y, w, h;
-  int oldx, oldy, oldw, oldh;
-  int basew, baseh, incw, inch, maxw, maxh, minw, minh;
-  int bw, oldbw;
-  unsigned int tags;
-  int isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen;
+  /* hot, read by every arrange and ISVISIBLE: first cache line, see dwm_pool.c */
+  Window win;
   dwm_client_t* next;
   dwm_client_t* snext;
   dwm_monitor_t* mon;
-  Window win;
+  int x, y, w, h;
+  unsigned int tags;
+  int bw;
+  unsigned int isfixed : 1, isfloating : 1, isurgent : 1, neverfocus : 1, oldstate : 1,
+    isfullscreen : 1, isunmapped : 1;
+  /* cold */
+  unsigned int title; /* dwm_title_t */
+  int oldx, oldy, oldw, oldh;
+  int sx, sy; /* position as last sent to the server, off screen while hidden */
+  unsigned int ignoreunmap; /* UnmapNotify events caused by hiding, see unmapnotify() */
+  Window container; /* parent with DWM_TAG_CONTAINERS, None while a child of the root */
+  unsigned int stackpos; /* index in mon->stacked, see restack() */
+  dwm_size_hints_t hints;
+  int oldbw;
+  unsigned int protocols;
+  unsigned int grabs; /* DwmGrab*, see _dwm_grab_buttons() */
+  /* window properties as of manage() or the last PropertyNotify */
+  unsigned int stale; /* DwmStale* bits of cached properties to refetch */
+  int haswmhints;
+  XWMHints wmhints;
+  Atom winstate; /* first atom of _NET_WM_STATE */
 } dwm_client_t;
 
 typedef struct {
@@ -45,7 +64,13 @@ typedef struct dwm_monitor_s {
   unsigned int tagset[2];
   int showbar;
   int topbar;
+  unsigned int dirty; /* work scheduled until the end of the event batch */
   dwm_client_t* clients;
+  /* visible tiled clients in list order and the number of visible ones, rebuilt
+   * when tiledstale is set, see _dwm_update_tiled() */
+  dwm_client_t** tiled;
+  unsigned int ntiled, tiledcap, nvisible;
+  int tiledstale;
   dwm_client_t* sel;
   dwm_client_t* stack;
   dwm_client_t* scratchpad;
@@ -53,6 +78,14 @@ typedef struct dwm_monitor_s {
   dwm_monitor_t* next;
   Window barwin;
   const dwm_layout_t* lt[2];
+  dwm_pertag_t* pertag; /* layout state of every tag, the fields above are the current */
+  /* the stacking restack() set up: the raised client, the tiled clients below
+   * the bar and, with DWM_TAG_CONTAINERS, the container of the selection */
+  Window raised;
+  dwm_client_t** stacked;
+  unsigned int nstacked, stackedcap;
+  Window container;
+  int containerraised;
 } dwm_monitor_t;
 
 // EWMH atoms
@@ -69,12 +102,19 @@ enum {
   NetWMWindowType,
   NetWMWindowTypeDialog,
   NetClientList,
+  NetWMPid,
   _NetLast
 };
-// Xembed atoms
-enum { Manager, Xembed, XembedInfo, _XLast };
+// Xembed and other atoms
+enum { Manager, Xembed, XembedInfo, Utf8String, _XLast };
 // default atoms
 enum { WMProtocols, WMDelete, WMState, WMTakeFocus, _WMLast };
+// WM_PROTOCOLS supported by a client
+enum { DwmProtoDelete = 1 << 0, DwmProtoTakeFocus = 1 << 1 };
+// cached client properties changed since they were fetched
+enum { DwmStaleState = 1 << 0 };
+// passive button grabs set up on a client window
+enum { DwmGrabNone, DwmGrabUnfocused, DwmGrabFocused };
 
 // https://unix.stackexchange.com/questions/367732/what-are-display-and-screen-with-regard-to-0-0
 // In X11 terminology.
@@ -125,5 +165,7 @@ extern XftColor** dwm_color_schemes;
 extern Atom dwm_x_wm_atoms[_WMLast];
 extern Atom dwm_x_net_atoms[_NetLast];
 extern Atom dwm_x_atoms[_XLast];
+extern unsigned long dwm_x_sync_count;
 
-static unsigned int dwm_num_lock_mask = 0;
+// modifier bit of NumLock, refreshed by mappingnotify()
+extern unsigned int dwm_num_lock_mask;
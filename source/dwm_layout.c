@@ -0,0 +1,244 @@
+#include "dwm_layout.h"
+
+#include "util.h"
+
+void dwm_size_hints_apply(const dwm_size_hints_t* hints, int* w, int* h) {
+  /* see last two sentences in ICCCM 4.1.2.3 */
+  int baseismin = hints->basew == hints->minw && hints->baseh == hints->minh;
+
+  if (!baseismin) { /* temporarily remove base dimensions */
+    *w -= hints->basew;
+    *h -= hints->baseh;
+  }
+  /* adjust for aspect limits */
+  if (hints->mina > 0 && hints->maxa > 0) {
+    if (hints->maxa < (float)*w / *h)
+      *w = *h * hints->maxa + 0.5;
+    else if (hints->mina < (float)*h / *w)
+      *h = *w * hints->mina + 0.5;
+  }
+  if (baseismin) { /* increment calculation requires this */
+    *w -= hints->basew;
+    *h -= hints->baseh;
+  }
+  /* adjust for increment value */
+  if (hints->incw)
+    *w -= *w % hints->incw;
+  if (hints->inch)
+    *h -= *h % hints->inch;
+  /* restore base dimensions */
+  *w = MAX(*w + hints->basew, hints->minw);
+  *h = MAX(*h + hints->baseh, hints->minh);
+  if (hints->maxw)
+    *w = MIN(*w, hints->maxw);
+  if (hints->maxh)
+    *h = MIN(*h, hints->maxh);
+}
+
+void dwm_layout_constrain(const dwm_layout_input_t* in,
+                          const dwm_layout_client_t* c,
+                          dwm_rect_t* r) {
+  const dwm_rect_t* a = &in->area;
+
+  r->w = MAX(1, r->w);
+  r->h = MAX(1, r->h);
+  if (r->x >= a->x + a->w)
+    r->x = a->x + a->w - (r->w + 2 * c->bw);
+  if (r->y >= a->y + a->h)
+    r->y = a->y + a->h - (r->h + 2 * c->bw);
+  if (r->x + r->w + 2 * c->bw <= a->x)
+    r->x = a->x;
+  if (r->y + r->h + 2 * c->bw <= a->y)
+    r->y = a->y;
+  r->w = MAX(r->w, in->min_size);
+  r->h = MAX(r->h, in->min_size);
+  if (c->hints)
+    dwm_size_hints_apply(c->hints, &r->w, &r->h);
+}
+
+void dwm_layout_tile(const dwm_layout_input_t* in, dwm_rect_t* out) {
+  unsigned int i, h, mw, my, ty;
+  const dwm_rect_t* a = &in->area;
+
+  if (in->n == 0)
+    return;
+
+  if (in->n > in->nmaster)
+    mw = in->nmaster ? a->w * in->mfact : 0;
+  else
+    mw = a->w;
+  for (i = my = ty = 0; i < in->n; i++) {
+    const dwm_layout_client_t* c = &in->clients[i];
+    dwm_rect_t* r = &out[i];
+    if (i < in->nmaster) {
+      h = (a->h - my) / (MIN(in->n, in->nmaster) - i);
+      *r = (dwm_rect_t){a->x, a->y + my, mw - 2 * c->bw, h - 2 * c->bw};
+      dwm_layout_constrain(in, c, r);
+      my += r->h + 2 * c->bw;
+    } else {
+      h = (a->h - ty) / (in->n - i);
+      *r = (dwm_rect_t){a->x + mw, a->y + ty, a->w - mw - 2 * c->bw, h - 2 * c->bw};
+      dwm_layout_constrain(in, c, r);
+      ty += r->h + 2 * c->bw;
+    }
+  }
+}
+
+void dwm_layout_monocle(const dwm_layout_input_t* in, dwm_rect_t* out) {
+  const dwm_rect_t* a = &in->area;
+
+  for (unsigned int i = 0; i < in->n; i++) {
+    const dwm_layout_client_t* c = &in->clients[i];
+    out[i] = (dwm_rect_t){a->x, a->y, a->w - 2 * c->bw, a->h - 2 * c->bw};
+    dwm_layout_constrain(in, c, &out[i]);
+  }
+}
+
+void dwm_layout_grid(const dwm_layout_input_t* in, dwm_rect_t* out) {
+  unsigned int i, cols, rows, col, row, cw, ch;
+  const dwm_rect_t* a = &in->area;
+
+  if (in->n == 0)
+    return;
+
+  for (cols = 0; cols <= in->n / 2; cols++)
+    if (cols * cols >= in->n)
+      break;
+  rows = in->n / cols;
+  cw = a->w / cols;
+  for (i = col = row = 0; i < in->n; i++) {
+    const dwm_layout_client_t* c = &in->clients[i];
+    dwm_rect_t* r = &out[i];
+    if (row == 0 && col >= cols - in->n % cols)
+      rows = in->n / cols + 1;
+    ch = a->h / rows;
+    /* the last column and row take the rounding remainder */
+    *r = (dwm_rect_t){a->x + col * cw,
+                      a->y + row * ch,
+                      (col == cols - 1 ? a->w - col * cw : cw) - 2 * c->bw,
+                      (row == rows - 1 ? a->h - row * ch : ch) - 2 * c->bw};
+    dwm_layout_constrain(in, c, r);
+    if (++row == rows) {
+      row = 0;
+      col++;
+    }
+  }
+}
+
+void dwm_layout_bstack(const dwm_layout_input_t* in, dwm_rect_t* out) {
+  unsigned int i, w, mh, mx, tx;
+  const dwm_rect_t* a = &in->area;
+
+  if (in->n == 0)
+    return;
+
+  if (in->n > in->nmaster)
+    mh = in->nmaster ? a->h * in->mfact : 0;
+  else
+    mh = a->h;
+  for (i = mx = tx = 0; i < in->n; i++) {
+    const dwm_layout_client_t* c = &in->clients[i];
+    dwm_rect_t* r = &out[i];
+    if (i < in->nmaster) {
+      w = (a->w - mx) / (MIN(in->n, in->nmaster) - i);
+      *r = (dwm_rect_t){a->x + mx, a->y, w - 2 * c->bw, mh - 2 * c->bw};
+      dwm_layout_constrain(in, c, r);
+      mx += r->w + 2 * c->bw;
+    } else {
+      w = (a->w - tx) / (in->n - i);
+      *r = (dwm_rect_t){a->x + tx, a->y + mh, w - 2 * c->bw, a->h - mh - 2 * c->bw};
+      dwm_layout_constrain(in, c, r);
+      tx += r->w + 2 * c->bw;
+    }
+  }
+}
+
+void dwm_layout_centeredmaster(const dwm_layout_input_t* in, dwm_rect_t* out) {
+  unsigned int i, j, h, nm, ns, mw, mx, lw, rw, my, ly, ry;
+  const dwm_rect_t* a = &in->area;
+
+  if (in->n == 0)
+    return;
+
+  nm = MIN(in->n, in->nmaster);
+  ns = in->n - nm;
+  mw = ns ? a->w * in->mfact : a->w;
+  if (!nm)
+    mw = 0;
+  /* a single stack client goes to the right of the masters */
+  lw = ns > 1 ? (a->w - mw) / 2 : 0;
+  rw = a->w - mw - lw;
+  mx = lw;
+  for (i = my = ly = ry = 0; i < in->n; i++) {
+    const dwm_layout_client_t* c = &in->clients[i];
+    dwm_rect_t* r = &out[i];
+    if (i < nm) {
+      h = (a->h - my) / (nm - i);
+      *r = (dwm_rect_t){a->x + mx, a->y + my, mw - 2 * c->bw, h - 2 * c->bw};
+      dwm_layout_constrain(in, c, r);
+      my += r->h + 2 * c->bw;
+    } else if ((j = i - nm) % 2 == 0) {
+      h = (a->h - ry) / ((ns - j + 1) / 2);
+      *r = (dwm_rect_t){a->x + mx + mw, a->y + ry, rw - 2 * c->bw, h - 2 * c->bw};
+      dwm_layout_constrain(in, c, r);
+      ry += r->h + 2 * c->bw;
+    } else {
+      h = (a->h - ly) / ((ns - j + 1) / 2);
+      *r = (dwm_rect_t){a->x, a->y + ly, lw - 2 * c->bw, h - 2 * c->bw};
+      dwm_layout_constrain(in, c, r);
+      ly += r->h + 2 * c->bw;
+    }
+  }
+}
+
+static void _fibonacci(const dwm_layout_input_t* in, dwm_rect_t* out, int dwindle) {
+  unsigned int i, split;
+  int x, y, w, h;
+  const dwm_rect_t* a = &in->area;
+
+  x = a->x;
+  y = 0;
+  w = a->w;
+  h = a->h;
+  for (i = split = 0; i < in->n; i++) {
+    const dwm_layout_client_t* c = &in->clients[i];
+    /* once the space is too small to split, the rest share the last rectangle */
+    if ((split % 2 && h / 2 > 2 * c->bw) || (!(split % 2) && w / 2 > 2 * c->bw)) {
+      if (split < in->n - 1) {
+        if (split % 2)
+          h /= 2;
+        else
+          w /= 2;
+        if (split % 4 == 2 && !dwindle)
+          x += w;
+        else if (split % 4 == 3 && !dwindle)
+          y += h;
+      }
+      if (split % 4 == 0)
+        y += dwindle ? h : -h;
+      else if (split % 4 == 1)
+        x += w;
+      else if (split % 4 == 2)
+        y += h;
+      else
+        x += dwindle ? w : -w;
+      if (split == 0) {
+        if (in->n != 1)
+          w = a->w * in->mfact;
+        y = a->y;
+      } else if (split == 1)
+        w = a->w - w;
+      split++;
+    }
+    out[i] = (dwm_rect_t){x, y, w - 2 * c->bw, h - 2 * c->bw};
+    dwm_layout_constrain(in, c, &out[i]);
+  }
+}
+
+void dwm_layout_spiral(const dwm_layout_input_t* in, dwm_rect_t* out) {
+  _fibonacci(in, out, 0);
+}
+
+void dwm_layout_dwindle(const dwm_layout_input_t* in, dwm_rect_t* out) {
+  _fibonacci(in, out, 1);
+}
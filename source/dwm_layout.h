@@ -0,0 +1,60 @@
+#pragma once
+
+// Layout kernels: pure functions from a compact description of the tiled
+// clients of a monitor to their target geometry, without touching X. dwm.c
+// gathers the input and commits the targets, see _dwm_arrange_tiled().
+
+typedef struct {
+  int x, y, w, h;
+} dwm_rect_t;
+
+// WM_NORMAL_HINTS as dwm_set_size_hints() stores them
+typedef struct {
+  float mina, maxa;
+  int basew, baseh, incw, inch, maxw, maxh, minw, minh;
+} dwm_size_hints_t;
+
+typedef struct {
+  int bw;
+  const dwm_size_hints_t* hints; /* NULL if size hints are not honoured */
+} dwm_layout_client_t;
+
+typedef struct {
+  unsigned int n;
+  const dwm_layout_client_t* clients;
+  float mfact;
+  unsigned int nmaster;
+  dwm_rect_t area; /* window area of the monitor */
+  int min_size; /* lower bound of widths and heights, the bar height */
+} dwm_layout_input_t;
+
+// Fills out[0..n) with the geometry of the clients, borders excluded.
+typedef void (*dwm_layout_kernel_t)(const dwm_layout_input_t* in, dwm_rect_t* out);
+
+void dwm_layout_tile(const dwm_layout_input_t* in, dwm_rect_t* out);
+
+void dwm_layout_monocle(const dwm_layout_input_t* in, dwm_rect_t* out);
+
+// columns of about sqrt(n) rows, the rightmost columns take one more
+void dwm_layout_grid(const dwm_layout_input_t* in, dwm_rect_t* out);
+
+// masters side by side on top, the stack side by side below
+void dwm_layout_bstack(const dwm_layout_input_t* in, dwm_rect_t* out);
+
+// masters in a center column, the stack alternates between right and left
+void dwm_layout_centeredmaster(const dwm_layout_input_t* in, dwm_rect_t* out);
+
+// Fibonacci tiling: every client halves the space left over by the previous
+// one, spiraling inwards or, for dwindle, always down and to the right.
+void dwm_layout_spiral(const dwm_layout_input_t* in, dwm_rect_t* out);
+
+void dwm_layout_dwindle(const dwm_layout_input_t* in, dwm_rect_t* out);
+
+// Keeps r, the geometry of c without borders, inside the area and within the
+// size hints, like dwm_apply_size_hints() does for arranged clients.
+void dwm_layout_constrain(const dwm_layout_input_t* in,
+                          const dwm_layout_client_t* c,
+                          dwm_rect_t* r);
+
+// adjusts w and h to aspect, increment, minimum and maximum hints
+void dwm_size_hints_apply(const dwm_size_hints_t* hints, int* w, int* h);
@@ -0,0 +1,187 @@
+#include "dwm_loop.h"
+
+#include "../def_config.h"
+#include "util.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define _MAX_SIGNAL 65
+
+typedef struct {
+  dwm_fd_handler_t handler;
+  void* data;
+} _fd_slot_t;
+
+typedef struct {
+  int id; /* 0 means the slot is free */
+  int64_t deadline; /* CLOCK_MONOTONIC, ms */
+  dwm_timer_handler_t handler;
+  void* data;
+} _timer_slot_t;
+
+static struct pollfd _pollfds[DWM_LOOP_MAX_FDS];
+static _fd_slot_t _fd_slots[DWM_LOOP_MAX_FDS];
+static int _nfds;
+
+static _timer_slot_t _timers[DWM_LOOP_MAX_TIMERS];
+static int _last_timer_id;
+static int _timer_fd = -1;
+
+static dwm_signal_handler_t _signal_handlers[_MAX_SIGNAL];
+static sigset_t _signal_mask;
+static int _signal_fd = -1;
+
+static int64_t _now_ms() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* arms the timerfd for the earliest pending deadline, disarms it if none */
+static void _arm_timer_fd() {
+  struct itimerspec its = {{0, 0}, {0, 0}};
+  int64_t next = 0;
+
+  for (int i = 0; i < DWM_LOOP_MAX_TIMERS; ++i)
+    if (_timers[i].id && (!next || _timers[i].deadline < next))
+      next = _timers[i].deadline;
+  if (next) {
+    /* a zero it_value disarms, so never ask for exactly 0 */
+    its.it_value.tv_sec = next / 1000;
+    its.it_value.tv_nsec = (next % 1000) * 1000000 + 1;
+  }
+  timerfd_settime(_timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void _on_timer_fd(int fd, short revents, void* data) {
+  uint64_t expirations;
+  int64_t now = _now_ms();
+
+  if (read(fd, &expirations, sizeof expirations) < 0 && errno != EAGAIN)
+    die("dwm: timerfd read:");
+  for (int i = 0; i < DWM_LOOP_MAX_TIMERS; ++i) {
+    if (!_timers[i].id || _timers[i].deadline > now)
+      continue;
+    _timer_slot_t t = _timers[i];
+    _timers[i].id = 0; /* one-shot, the handler may schedule a new one */
+    t.handler(t.data);
+  }
+  _arm_timer_fd();
+}
+
+static void _on_signal_fd(int fd, short revents, void* data) {
+  struct signalfd_siginfo si;
+
+  while (read(fd, &si, sizeof si) == sizeof si)
+    if (si.ssi_signo < _MAX_SIGNAL && _signal_handlers[si.ssi_signo])
+      _signal_handlers[si.ssi_signo](si.ssi_signo);
+}
+
+void dwm_loop_init() {
+  sigemptyset(&_signal_mask);
+  if ((_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0)
+    die("dwm: timerfd_create:");
+  if ((_signal_fd = signalfd(-1, &_signal_mask, SFD_NONBLOCK | SFD_CLOEXEC)) < 0)
+    die("dwm: signalfd:");
+  dwm_loop_add_fd(_timer_fd, POLLIN, _on_timer_fd, NULL);
+  dwm_loop_add_fd(_signal_fd, POLLIN, _on_signal_fd, NULL);
+}
+
+void dwm_loop_release() {
+  dwm_loop_restore_signals();
+  close(_timer_fd);
+  close(_signal_fd);
+  _timer_fd = _signal_fd = -1;
+  _nfds = 0;
+}
+
+int dwm_loop_add_fd(int fd, short events, dwm_fd_handler_t handler, void* data) {
+  int i;
+
+  /* reuse a slot freed by dwm_loop_remove_fd() */
+  for (i = 0; i < _nfds && _pollfds[i].fd >= 0; ++i)
+    ;
+  if (i == DWM_LOOP_MAX_FDS)
+    return 0;
+  if (i == _nfds)
+    ++_nfds;
+  _pollfds[i].fd = fd;
+  _pollfds[i].events = events;
+  _pollfds[i].revents = 0;
+  _fd_slots[i].handler = handler;
+  _fd_slots[i].data = data;
+  return 1;
+}
+
+void dwm_loop_remove_fd(int fd) {
+  for (int i = 0; i < _nfds; ++i)
+    if (_pollfds[i].fd == fd) {
+      /* poll(2) ignores negative fds, the slot stays until reused */
+      _pollfds[i].fd = -1;
+      _pollfds[i].revents = 0;
+      _fd_slots[i].handler = NULL;
+    }
+}
+
+int dwm_loop_add_timer(unsigned int ms, dwm_timer_handler_t handler, void* data) {
+  for (int i = 0; i < DWM_LOOP_MAX_TIMERS; ++i) {
+    if (_timers[i].id)
+      continue;
+    if (++_last_timer_id <= 0)
+      _last_timer_id = 1;
+    _timers[i].id = _last_timer_id;
+    _timers[i].deadline = _now_ms() + ms;
+    _timers[i].handler = handler;
+    _timers[i].data = data;
+    _arm_timer_fd();
+    return _timers[i].id;
+  }
+  return 0;
+}
+
+void dwm_loop_cancel_timer(int id) {
+  for (int i = 0; i < DWM_LOOP_MAX_TIMERS; ++i)
+    if (id && _timers[i].id == id) {
+      _timers[i].id = 0;
+      _arm_timer_fd();
+    }
+}
+
+void dwm_loop_on_signal(int signo, dwm_signal_handler_t handler) {
+  if (signo <= 0 || signo >= _MAX_SIGNAL)
+    return;
+  _signal_handlers[signo] = handler;
+  sigaddset(&_signal_mask, signo);
+  if (sigprocmask(SIG_BLOCK, &_signal_mask, NULL) < 0)
+    die("dwm: sigprocmask:");
+  if (signalfd(_signal_fd, &_signal_mask, 0) < 0)
+    die("dwm: signalfd:");
+}
+
+void dwm_loop_restore_signals() {
+  sigprocmask(SIG_UNBLOCK, &_signal_mask, NULL);
+}
+
+void dwm_loop_poll() {
+  int n = _nfds;
+
+  if (poll(_pollfds, n, -1) < 0) {
+    if (errno == EINTR)
+      return;
+    die("dwm: poll:");
+  }
+  for (int i = 0; i < n; ++i) {
+    short revents = _pollfds[i].revents;
+    _pollfds[i].revents = 0;
+    if (revents && _pollfds[i].fd >= 0 && _fd_slots[i].handler)
+      _fd_slots[i].handler(_pollfds[i].fd, revents, _fd_slots[i].data);
+  }
+}
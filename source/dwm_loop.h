@@ -0,0 +1,34 @@
+#pragma once
+
+typedef void (*dwm_fd_handler_t)(int fd, short revents, void* data);
+typedef void (*dwm_timer_handler_t)(void* data);
+typedef void (*dwm_signal_handler_t)(int signo);
+
+// Creates the timerfd and the signalfd the main loop multiplexes next to the
+// X connection. Must be called before any other dwm_loop function.
+void dwm_loop_init();
+
+void dwm_loop_release();
+
+// Watches fd for the poll(2) events; handler runs from dwm_loop_poll() when
+// the fd becomes ready. Returns 0 if no slot is left.
+int dwm_loop_add_fd(int fd, short events, dwm_fd_handler_t handler, void* data);
+
+void dwm_loop_remove_fd(int fd);
+
+// One-shot timer firing after ms milliseconds. Returns a positive id usable
+// with dwm_loop_cancel_timer(), or 0 if no slot is left.
+int dwm_loop_add_timer(unsigned int ms, dwm_timer_handler_t handler, void* data);
+
+void dwm_loop_cancel_timer(int id);
+
+// Blocks signo and delivers it through the signalfd instead, so handler runs
+// from the main loop and not in signal context.
+void dwm_loop_on_signal(int signo, dwm_signal_handler_t handler);
+
+// Unblocks the signals taken over by the loop; to be called in forked
+// children before exec.
+void dwm_loop_restore_signals();
+
+// Waits until one of the watched fds is ready and runs the handlers.
+void dwm_loop_poll();
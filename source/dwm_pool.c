@@ -0,0 +1,63 @@
+#include "dwm_pool.h"
+
+#include "util.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _CACHE_LINE 64
+#define _SLAB_SLOTS 32
+
+_Static_assert(offsetof(dwm_client_t, title) <= _CACHE_LINE,
+               "hot client fields must fit the first cache line");
+
+typedef struct {
+  _Alignas(_CACHE_LINE) dwm_client_t client;
+} _slot_t;
+
+typedef struct _slab_s {
+  struct _slab_s* next;
+  _slot_t slots[_SLAB_SLOTS];
+} _slab_t;
+
+static _slab_t* _slabs;
+static dwm_client_t* _free; /* linked through next */
+
+static void _grow() {
+  _slab_t* slab = aligned_alloc(_CACHE_LINE, sizeof(_slab_t));
+
+  if (!slab)
+    die("aligned_alloc:");
+  slab->next = _slabs;
+  _slabs = slab;
+  for (int i = _SLAB_SLOTS - 1; i >= 0; --i) {
+    slab->slots[i].client.next = _free;
+    _free = &slab->slots[i].client;
+  }
+}
+
+dwm_client_t* dwm_alloc_client() {
+  dwm_client_t* c;
+
+  if (!_free)
+    _grow();
+  c = _free;
+  _free = c->next;
+  memset(c, 0, sizeof *c);
+  return c;
+}
+
+void dwm_free_client(dwm_client_t* c) {
+  c->next = _free;
+  _free = c;
+}
+
+void dwm_release_client_pool() {
+  while (_slabs) {
+    _slab_t* next = _slabs->next;
+    free(_slabs);
+    _slabs = next;
+  }
+  _free = NULL;
+}
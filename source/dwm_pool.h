@@ -0,0 +1,15 @@
+#pragma once
+
+#include "dwm_global.h"
+
+// Clients and systray icons come from slabs of cache line aligned slots that
+// are recycled through a free list, so that weeks of mapping and unmapping
+// windows don't fragment the heap. Slabs are only returned to the heap by
+// dwm_release_client_pool().
+
+// zeroed client
+dwm_client_t* dwm_alloc_client();
+
+void dwm_free_client(dwm_client_t* c);
+
+void dwm_release_client_pool();
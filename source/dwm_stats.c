@@ -0,0 +1,146 @@
+#include "dwm_stats.h"
+
+#include "dwm_global.h"
+#include "util.h"
+
+#include <time.h>
+
+typedef struct {
+  unsigned long calls;
+  unsigned long requests;
+  unsigned long round_trips;
+  dwm_histogram_t latency;
+} _stat_t;
+
+static _stat_t _stats[_DwmStatLast];
+static unsigned long _round_trips;
+static unsigned long _last_request_read;
+
+static const char* _slot_names[_DwmStatLast] = {
+  [KeyPress] = "KeyPress",
+  [ButtonPress] = "ButtonPress",
+  [MotionNotify] = "MotionNotify",
+  [EnterNotify] = "EnterNotify",
+  [FocusIn] = "FocusIn",
+  [Expose] = "Expose",
+  [DestroyNotify] = "DestroyNotify",
+  [UnmapNotify] = "UnmapNotify",
+  [MapRequest] = "MapRequest",
+  [ConfigureNotify] = "ConfigureNotify",
+  [ConfigureRequest] = "ConfigureRequest",
+  [ResizeRequest] = "ResizeRequest",
+  [PropertyNotify] = "PropertyNotify",
+  [ClientMessage] = "ClientMessage",
+  [MappingNotify] = "MappingNotify",
+  [DwmStatManage] = "manage",
+  [DwmStatRestack] = "restack",
+  [DwmStatDrawbar] = "drawbar",
+  [DwmStatUpdateSystray] = "dwm_update_systray",
+  [DwmStatFlush] = "flush",
+};
+
+/* Called by Xlib after every request function. Xlib offers no hook for
+ * replies, but when the last request sent is already known to be processed
+ * right after the call, the call has waited for the server. */
+static int _after_request(Display* dpy) {
+  unsigned long read = LastKnownRequestProcessed(dpy);
+
+  if (read != _last_request_read && read == NextRequest(dpy) - 1)
+    ++_round_trips;
+  _last_request_read = read;
+  return 0;
+}
+
+void dwm_stats_init() {
+  _last_request_read = LastKnownRequestProcessed(dwm_x_display);
+  XSetAfterFunction(dwm_x_display, _after_request);
+}
+
+dwm_stats_scope_t dwm_stats_begin(int slot) {
+  dwm_stats_scope_t scope
+    = {slot, NextRequest(dwm_x_display), _round_trips, dwm_stats_now_us()};
+
+  return scope;
+}
+
+void dwm_stats_end(const dwm_stats_scope_t* scope) {
+  _stat_t* s = &_stats[scope->slot];
+
+  ++s->calls;
+  s->requests += NextRequest(dwm_x_display) - scope->request;
+  s->round_trips += _round_trips - scope->round_trips;
+  dwm_histogram_add(&s->latency, dwm_stats_now_us() - scope->start_us);
+}
+
+void dwm_stats_note_round_trip() { ++_round_trips; }
+
+void dwm_stats_dump(FILE* f) {
+  for (int i = 0; i < _DwmStatLast; ++i) {
+    const _stat_t* s = &_stats[i];
+    if (!s->calls)
+      continue;
+    if (_slot_names[i])
+      fprintf(f, "dwm: stats %s", _slot_names[i]);
+    else
+      fprintf(f, "dwm: stats event%d", i);
+    fprintf(f,
+            " calls %lu requests %lu round_trips %lu\n",
+            s->calls,
+            s->requests,
+            s->round_trips);
+  }
+  fprintf(f, "dwm: stats total round_trips %lu\n", _round_trips);
+  for (int i = 0; i < _DwmStatLast; ++i) {
+    char name[32];
+    if (!_stats[i].calls)
+      continue;
+    if (_slot_names[i])
+      dwm_histogram_dump(f, _slot_names[i], &_stats[i].latency);
+    else {
+      snprintf(name, sizeof name, "event%d", i);
+      dwm_histogram_dump(f, name, &_stats[i].latency);
+    }
+  }
+}
+
+unsigned long dwm_stats_now_us() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void dwm_histogram_add(dwm_histogram_t* h, unsigned long us) {
+  int i = 0;
+
+  while (i < DWM_STATS_BUCKETS - 1 && us >> (i + 1))
+    ++i;
+  ++h->buckets[i];
+  ++h->count;
+  if (us > h->max_us)
+    h->max_us = us;
+}
+
+/* upper bound of the bucket holding the p-th percentile, capped by the max */
+static unsigned long _percentile(const dwm_histogram_t* h, unsigned int p) {
+  unsigned long rank = (h->count * p + 99) / 100, seen = 0;
+
+  for (int i = 0; i < DWM_STATS_BUCKETS; ++i) {
+    seen += h->buckets[i];
+    if (seen >= rank)
+      return MIN((2UL << i) - 1, h->max_us);
+  }
+  return h->max_us;
+}
+
+void dwm_histogram_dump(FILE* f, const char* name, const dwm_histogram_t* h) {
+  if (!h->count)
+    return;
+  fprintf(f,
+          "dwm: latency %s count %lu p50_us %lu p99_us %lu max_us %lu\n",
+          name,
+          h->count,
+          _percentile(h, 50),
+          _percentile(h, 99),
+          h->max_us);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <X11/Xlib.h>
+
+#include <stdio.h>
+
+// Protocol cost accounting. Slots below LASTEvent are the X event types as
+// dispatched through the handler table, the ones above are dwm's own code paths.
+enum {
+  DwmStatManage = LASTEvent,
+  DwmStatRestack,
+  DwmStatDrawbar,
+  DwmStatUpdateSystray,
+  DwmStatFlush,
+  _DwmStatLast
+};
+
+// bucket i counts latencies below 2^(i+1) microseconds
+#define DWM_STATS_BUCKETS 32
+
+typedef struct {
+  unsigned long count;
+  unsigned long max_us;
+  unsigned long buckets[DWM_STATS_BUCKETS];
+} dwm_histogram_t;
+
+typedef struct {
+  int slot;
+  unsigned long request;
+  unsigned long round_trips;
+  unsigned long start_us;
+} dwm_stats_scope_t;
+
+// Hooks into dwm_x_display to watch for requests answered by a reply.
+void dwm_stats_init();
+
+// Everything sent between begin and end is accounted to slot. Scopes nest and
+// are inclusive: requests of manage() also count for the MapRequest handler.
+dwm_stats_scope_t dwm_stats_begin(int slot);
+
+void dwm_stats_end(const dwm_stats_scope_t* scope);
+
+// Accounts a reply waited for outside of Xlib, e.g. over XCB.
+void dwm_stats_note_round_trip();
+
+void dwm_stats_dump(FILE* f);
+
+// CLOCK_MONOTONIC in microseconds
+unsigned long dwm_stats_now_us();
+
+void dwm_histogram_add(dwm_histogram_t* h, unsigned long us);
+
+// one line "dwm: latency <name> count .. p50_us .. p99_us .. max_us .."; the
+// percentiles are bucket upper bounds
+void dwm_histogram_dump(FILE* f, const char* name, const dwm_histogram_t* h);
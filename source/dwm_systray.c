@@ -4,6 +4,9 @@
 #include "drw.h"
 #include "dwm_core.h"
 #include "dwm_enum.h"
+#include "dwm_pool.h"
+#include "dwm_stats.h"
+#include "dwm_winmap.h"
 #include "util.h"
 
 #include <X11/Xatom.h>
@@ -30,13 +33,9 @@ static dwm_client_t* _systray_icons;
 static unsigned long systrayorientation = _NET_SYSTEM_TRAY_ORIENTATION_HORZ;
 
 dwm_client_t* dwm_find_systray_icon_client(Window w) {
-  if (!DWM_HAS_SYSTRAY || !w)
+  if (!DWM_HAS_SYSTRAY)
     return NULL;
-
-  dwm_client_t* i = _systray_icons;
-  for (; i && i->win != w; i = i->next)
-    ;
-  return i;
+  return dwm_winmap_find_client(w, DwmWinTrayIcon);
 }
 
 dwm_monitor_t* dwm_find_systray_monitor(dwm_monitor_t* m) {
@@ -105,6 +104,7 @@ void dwm_create_systray() {
     dwm_x_display, dwm_x_net_atoms[NetSystemTray], _systray_window, CurrentTime);
   if (XGetSelectionOwner(dwm_x_display, dwm_x_net_atoms[NetSystemTray])
       == _systray_window) {
+    dwm_winmap_insert(_systray_window, DwmWinTray, NULL, NULL);
     dwm_send_x_event(dwm_x_window,
                      dwm_x_atoms[Manager],
                      StructureNotifyMask,
@@ -113,7 +113,7 @@ void dwm_create_systray() {
                      _systray_window,
                      0,
                      0);
-    XSync(dwm_x_display, False);
+    dwm_x_sync(False);
   } else {
     fprintf(stderr, "dwm: unable to obtain system tray.\n");
     dwm_release_systray();
@@ -129,6 +129,7 @@ void dwm_update_systray() {
   dwm_monitor_t* m = dwm_find_systray_monitor(NULL);
   unsigned int x = m->mx + m->mw;
   unsigned int w = 0;
+  dwm_stats_scope_t stats = dwm_stats_begin(DwmStatUpdateSystray);
 
   for (dwm_client_t* i = _systray_icons; i; i = i->next) {
     /* make sure the background color stays the same */
@@ -161,24 +162,27 @@ void dwm_update_systray() {
   XSetForeground(
     dwm_x_display, dwm_drw->gc, dwm_color_schemes[DwmNormalScheme][DwmBgColor].pixel);
   XFillRectangle(dwm_x_display, _systray_window, dwm_drw->gc, 0, 0, w, dwm_bar_height);
-  XSync(dwm_x_display, False);
+  dwm_stats_end(&stats);
 }
 
 void dwm_release_systray() {
   if (!DWM_HAS_SYSTRAY)
     return;
 
+  dwm_winmap_remove(_systray_window);
   XUnmapWindow(dwm_x_display, _systray_window);
   XDestroyWindow(dwm_x_display, _systray_window);
 
-  for (dwm_client_t* t = _systray_icons->next; _systray_icons; _systray_icons = t)
-    free(_systray_icons);
+  while (_systray_icons)
+    dwm_remove_systray_icon(_systray_icons);
 }
 
 int dwm_is_systray_window(Window win) {
-  return DWM_HAS_SYSTRAY && win == _systray_window;
+  return DWM_HAS_SYSTRAY && dwm_winmap_find(win).kind == DwmWinTray;
 }
 
+Window dwm_get_systray_window() { return DWM_HAS_SYSTRAY ? _systray_window : None; }
+
 void dwm_raise_systray(dwm_monitor_t* m) {
   if (!DWM_HAS_SYSTRAY)
     return;
@@ -201,13 +205,17 @@ void dwm_toggle_systray() {
 }
 
 dwm_client_t* dwm_add_systray_icon(Window win) {
-  dwm_client_t* c = (dwm_client_t*)calloc(1, sizeof(dwm_client_t));
-  if (!c)
-    die("fatal: could not malloc() %u bytes\n", sizeof(dwm_client_t));
+  dwm_client_t* c;
+
+  /* a client or an icon already docked */
+  if (dwm_winmap_find(win).kind != DwmWinNone)
+    return NULL;
+  c = dwm_alloc_client();
   c->win = win;
   c->mon = dwm_this_monitor;
   c->next = _systray_icons;
   _systray_icons = c;
+  dwm_winmap_insert(win, DwmWinTrayIcon, c, NULL);
   XWindowAttributes wa;
   XGetWindowAttributes(dwm_x_display, c->win, &wa);
   c->x = c->oldx = c->y = c->oldy = 0;
@@ -254,7 +262,7 @@ dwm_client_t* dwm_add_systray_icon(Window win) {
                    0,
                    _systray_window,
                    XEMBED_EMBEDDED_VERSION);
-  XSync(dwm_x_display, False);
+  dwm_x_sync(False);
   return c;
 }
 
@@ -318,9 +326,10 @@ void dwm_remove_systray_icon(dwm_client_t* i) {
   dwm_client_t** ii;
   for (ii = &_systray_icons; *ii && *ii != i; ii = &(*ii)->next)
     ;
-  if (ii)
+  if (*ii)
     *ii = i->next;
-  free(i);
+  dwm_winmap_remove(i->win);
+  dwm_free_client(i);
 }
 
 void dwm_send_systray_icon_window_active(Window win) {
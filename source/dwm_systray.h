@@ -18,6 +18,9 @@ void dwm_release_systray();
 
 int dwm_is_systray_window(Window win);
 
+// None without a systray
+Window dwm_get_systray_window();
+
 void dwm_raise_systray(dwm_monitor_t* m);
 
 void dwm_toggle_systray();
@@ -0,0 +1,165 @@
+#include "dwm_title.h"
+
+#include "drw.h"
+#include "dwm_global.h"
+#include "util.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _MIN_ARENA 4096
+#define _MIN_BUCKETS 64
+
+typedef struct {
+  size_t offset; /* into _text, NUL terminated */
+  unsigned int len, hash, width, refs;
+  unsigned int next; /* next entry of the bucket or of the free list */
+} _entry_t;
+
+static _entry_t* _entries; /* entry 0 is unused, 0 is no title */
+static unsigned int _nentries, _capacity, _free_entry, _live;
+static unsigned int* _buckets;
+static unsigned int _nbuckets;
+static char* _text;
+static size_t _used, _size, _garbage;
+
+/* FNV-1a */
+static unsigned int _hash(const char* text, size_t len) {
+  uint32_t h = 2166136261U;
+
+  for (size_t i = 0; i < len; ++i)
+    h = (h ^ (unsigned char)text[i]) * 16777619U;
+  return h;
+}
+
+static void _rehash(unsigned int nbuckets) {
+  free(_buckets);
+  _buckets = ecalloc(nbuckets, sizeof *_buckets);
+  _nbuckets = nbuckets;
+  for (unsigned int i = 1; i < _nentries; ++i) {
+    _entry_t* e = &_entries[i];
+    if (!e->refs)
+      continue;
+    e->next = _buckets[e->hash & (_nbuckets - 1)];
+    _buckets[e->hash & (_nbuckets - 1)] = i;
+  }
+}
+
+/* moves the live titles to a fresh arena, dropping released ones */
+static void _compact(size_t size) {
+  char* text = malloc(size);
+  size_t used = 0;
+
+  if (!text)
+    die("malloc:");
+  for (unsigned int i = 1; i < _nentries; ++i) {
+    _entry_t* e = &_entries[i];
+    if (!e->refs)
+      continue;
+    memcpy(text + used, _text + e->offset, e->len + 1);
+    e->offset = used;
+    used += e->len + 1;
+  }
+  free(_text);
+  _text = text;
+  _size = size;
+  _used = used;
+  _garbage = 0;
+}
+
+static size_t _store(const char* text, size_t len) {
+  size_t offset, size = _size ? _size : _MIN_ARENA;
+
+  if (_used + len + 1 > _size) {
+    while (_used - _garbage + len + 1 > size / 2)
+      size *= 2;
+    _compact(size);
+  }
+  offset = _used;
+  memcpy(_text + offset, text, len);
+  _text[offset + len] = '\0';
+  _used += len + 1;
+  return offset;
+}
+
+static unsigned int _new_entry() {
+  unsigned int i;
+
+  if (_free_entry) {
+    i = _free_entry;
+    _free_entry = _entries[i].next;
+    return i;
+  }
+  if (!_nentries)
+    _nentries = 1;
+  if (_nentries >= _capacity) {
+    _capacity = _capacity ? _capacity * 2 : _MIN_BUCKETS;
+    if (!(_entries = realloc(_entries, _capacity * sizeof *_entries)))
+      die("realloc:");
+  }
+  return _nentries++;
+}
+
+dwm_title_t dwm_title_intern(const char* text, size_t len) {
+  unsigned int h = _hash(text, len), i;
+  size_t offset;
+  _entry_t* e;
+
+  for (i = _nbuckets ? _buckets[h & (_nbuckets - 1)] : 0; i; i = _entries[i].next) {
+    e = &_entries[i];
+    if (e->hash == h && e->len == len && !memcmp(_text + e->offset, text, len)) {
+      ++e->refs;
+      return i;
+    }
+  }
+
+  /* before taking an entry, compacting only looks at initialized ones */
+  offset = _store(text, len);
+  i = _new_entry();
+  e = &_entries[i];
+  e->offset = offset;
+  e->len = len;
+  e->hash = h;
+  e->width = dwm_drw_primary_font_width(dwm_drw, _text + e->offset, len);
+  e->refs = 1;
+  if (++_live > _nbuckets)
+    _rehash(_nbuckets ? _nbuckets * 2 : _MIN_BUCKETS);
+  else {
+    e->next = _buckets[h & (_nbuckets - 1)];
+    _buckets[h & (_nbuckets - 1)] = i;
+  }
+  return i;
+}
+
+void dwm_title_release(dwm_title_t t) {
+  _entry_t* e;
+  unsigned int* i;
+
+  if (!t || --(e = &_entries[t])->refs)
+    return;
+  for (i = &_buckets[e->hash & (_nbuckets - 1)]; *i != t; i = &_entries[*i].next)
+    ;
+  *i = e->next;
+  _garbage += e->len + 1;
+  e->next = _free_entry;
+  _free_entry = t;
+  --_live;
+}
+
+const char* dwm_title_text(dwm_title_t t) { return t ? _text + _entries[t].offset : ""; }
+
+unsigned int dwm_title_len(dwm_title_t t) { return t ? _entries[t].len : 0; }
+
+unsigned int dwm_title_width(dwm_title_t t) { return t ? _entries[t].width : 0; }
+
+void dwm_title_release_all() {
+  free(_entries);
+  free(_buckets);
+  free(_text);
+  _entries = NULL;
+  _buckets = NULL;
+  _text = NULL;
+  _nentries = _capacity = _free_entry = _live = _nbuckets = 0;
+  _used = _size = _garbage = 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+
+// Client titles, interned in a growable string arena so that clients with the
+// same title share one copy. A title has an explicit length, its hash and its
+// width in the first font of dwm_drw, measured once when it is interned.
+// Handles stay valid until released, the pointers of dwm_title_text() only
+// until the next dwm_title_intern().
+
+typedef unsigned int dwm_title_t; // 0 is no title
+
+dwm_title_t dwm_title_intern(const char* text, size_t len);
+
+void dwm_title_release(dwm_title_t t);
+
+// "" for no title
+const char* dwm_title_text(dwm_title_t t);
+
+unsigned int dwm_title_len(dwm_title_t t);
+
+// see dwm_drw_primary_font_width()
+unsigned int dwm_title_width(dwm_title_t t);
+
+void dwm_title_release_all();
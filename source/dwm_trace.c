@@ -0,0 +1,434 @@
+#include "dwm_trace.h"
+
+#include "dwm_global.h"
+#include "dwm_stats.h"
+#include "util.h"
+
+#include <X11/Xatom.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _VERSION 3
+#define _SYSTEM_TRAY_REQUEST_DOCK 0
+
+enum { _RecordEvent, _RecordBatchEnd, _RecordAtom };
+
+typedef struct {
+  uint64_t delta_us; /* idle gaps of a recorded day exceed 32 bits */
+  uint16_t kind;
+  uint16_t size;
+} _record_t;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t nwindows;
+  uint64_t windows[DWM_TRACE_MAX_WINDOWS];
+} _header_t;
+
+typedef struct {
+  unsigned long from, to;
+  int standin; /* created for the replay, destroyed at the end of the trace */
+} _mapping_t;
+
+static const char _magic[8] = {'D', 'W', 'M', 'T', 'R', 'A', 'C', 'E'};
+
+static FILE* _file;
+static int _recording;
+static unsigned long _last_us;
+
+/* recording: atoms seen in events, named at the end of the trace */
+static Atom* _seen_atoms;
+static int _nseen_atoms;
+
+/* replaying */
+static _mapping_t* _windows;
+static int _nwindows;
+static _mapping_t* _atoms;
+static int _natoms;
+static Window* _doomed; /* destroyed stand-ins, kept until their batch is done */
+static int _ndoomed;
+static long _first_record;
+static int _eof, _done, _in_batch;
+
+/* grows array by doubling, so it has room for element n */
+static void* _grow(void* array, int n, size_t size) {
+  if (n && (n & (n - 1)))
+    return array;
+  if (!(array = realloc(array, (n ? 2 * n : 1) * size)))
+    die("dwm: realloc:");
+  return array;
+}
+
+static size_t _event_size(int type) {
+  switch (type) {
+  case KeyPress:
+  case KeyRelease:
+    return sizeof(XKeyEvent);
+  case ButtonPress:
+  case ButtonRelease:
+    return sizeof(XButtonEvent);
+  case MotionNotify:
+    return sizeof(XMotionEvent);
+  case EnterNotify:
+  case LeaveNotify:
+    return sizeof(XCrossingEvent);
+  case FocusIn:
+  case FocusOut:
+    return sizeof(XFocusChangeEvent);
+  case Expose:
+    return sizeof(XExposeEvent);
+  case CreateNotify:
+    return sizeof(XCreateWindowEvent);
+  case DestroyNotify:
+    return sizeof(XDestroyWindowEvent);
+  case UnmapNotify:
+    return sizeof(XUnmapEvent);
+  case MapNotify:
+    return sizeof(XMapEvent);
+  case MapRequest:
+    return sizeof(XMapRequestEvent);
+  case ReparentNotify:
+    return sizeof(XReparentEvent);
+  case ConfigureNotify:
+    return sizeof(XConfigureEvent);
+  case ConfigureRequest:
+    return sizeof(XConfigureRequestEvent);
+  case ResizeRequest:
+    return sizeof(XResizeRequestEvent);
+  case PropertyNotify:
+    return sizeof(XPropertyEvent);
+  case ClientMessage:
+    return sizeof(XClientMessageEvent);
+  case MappingNotify:
+    return sizeof(XMappingEvent);
+  default:
+    return sizeof(XEvent);
+  }
+}
+
+/* applies f to every atom of e dwm looks at */
+static void _for_each_atom(XEvent* e, Atom (*f)(Atom)) {
+  switch (e->type) {
+  case PropertyNotify:
+    e->xproperty.atom = f(e->xproperty.atom);
+    break;
+  case ClientMessage:
+    e->xclient.message_type = f(e->xclient.message_type);
+    if (e->xclient.format == 32
+        && e->xclient.message_type == dwm_x_net_atoms[NetWMState]) {
+      e->xclient.data.l[1] = f(e->xclient.data.l[1]);
+      e->xclient.data.l[2] = f(e->xclient.data.l[2]);
+    }
+    break;
+  }
+}
+
+/* applies f to every window of e, create is set for the window the event is
+ * about if a stand-in may be created for it */
+static void _for_each_window(XEvent* e, Window (*f)(Window, int create)) {
+  switch (e->type) {
+  case KeyPress:
+  case KeyRelease:
+    e->xkey.root = f(e->xkey.root, 0);
+    e->xkey.subwindow = f(e->xkey.subwindow, 0);
+    break;
+  case ButtonPress:
+  case ButtonRelease:
+    e->xbutton.root = f(e->xbutton.root, 0);
+    e->xbutton.subwindow = f(e->xbutton.subwindow, 0);
+    break;
+  case MotionNotify:
+    e->xmotion.root = f(e->xmotion.root, 0);
+    e->xmotion.subwindow = f(e->xmotion.subwindow, 0);
+    break;
+  case EnterNotify:
+  case LeaveNotify:
+    e->xcrossing.root = f(e->xcrossing.root, 0);
+    e->xcrossing.subwindow = f(e->xcrossing.subwindow, 0);
+    break;
+  case CreateNotify:
+    e->xcreatewindow.window = f(e->xcreatewindow.window, 1);
+    break;
+  case DestroyNotify:
+    e->xdestroywindow.window = f(e->xdestroywindow.window, 0);
+    break;
+  case UnmapNotify:
+    e->xunmap.window = f(e->xunmap.window, 0);
+    break;
+  case MapNotify:
+    e->xmap.window = f(e->xmap.window, 0);
+    break;
+  case MapRequest:
+    e->xmaprequest.window = f(e->xmaprequest.window, 1);
+    break;
+  case ReparentNotify:
+    e->xreparent.window = f(e->xreparent.window, 0);
+    e->xreparent.parent = f(e->xreparent.parent, 0);
+    break;
+  case ConfigureNotify:
+    e->xconfigure.window = f(e->xconfigure.window, 0);
+    e->xconfigure.above = f(e->xconfigure.above, 0);
+    break;
+  case ConfigureRequest:
+    e->xconfigurerequest.window = f(e->xconfigurerequest.window, 1);
+    e->xconfigurerequest.above = f(e->xconfigurerequest.above, 0);
+    break;
+  case PropertyNotify:
+  case ClientMessage:
+    e->xany.window = f(e->xany.window, 1);
+    if (e->type == ClientMessage
+        && e->xclient.message_type == dwm_x_net_atoms[NetSystemTrayOP]
+        && e->xclient.data.l[1] == _SYSTEM_TRAY_REQUEST_DOCK)
+      e->xclient.data.l[2] = f(e->xclient.data.l[2], 1);
+    return;
+  }
+  /* the window the event was reported on, often the parent or the root */
+  e->xany.window = f(e->xany.window, 0);
+}
+
+static void _write_record(int kind, size_t size) {
+  unsigned long now = dwm_stats_now_us();
+  _record_t r = {now - _last_us, kind, size};
+
+  _last_us = now;
+  fwrite(&r, sizeof r, 1, _file);
+}
+
+static Atom _note_atom(Atom atom) {
+  if (atom == None || atom <= XA_LAST_PREDEFINED)
+    return atom;
+  for (int i = 0; i < _nseen_atoms; ++i)
+    if (_seen_atoms[i] == atom)
+      return atom;
+  _seen_atoms = _grow(_seen_atoms, _nseen_atoms, sizeof(Atom));
+  _seen_atoms[_nseen_atoms++] = atom;
+  return atom;
+}
+
+/* all names in a single round trip, none while events are being recorded */
+static void _write_atom_names() {
+  char** names;
+  uint64_t a;
+
+  if (!_nseen_atoms)
+    return;
+  names = ecalloc(_nseen_atoms, sizeof *names);
+  if (XGetAtomNames(dwm_x_display, _seen_atoms, _nseen_atoms, names))
+    for (int i = 0; i < _nseen_atoms; ++i) {
+      a = _seen_atoms[i];
+      _write_record(_RecordAtom, sizeof a + strlen(names[i]));
+      fwrite(&a, sizeof a, 1, _file);
+      fwrite(names[i], strlen(names[i]), 1, _file);
+      XFree(names[i]);
+    }
+  free(names);
+}
+
+int dwm_trace_start_recording(const char* path, const Window* windows, int n) {
+  _header_t h = {{0}, _VERSION, MIN(n, DWM_TRACE_MAX_WINDOWS), {0}};
+
+  if (!(_file = fopen(path, "wb")))
+    return 0;
+  memcpy(h.magic, _magic, sizeof h.magic);
+  for (unsigned int i = 0; i < h.nwindows; ++i)
+    h.windows[i] = windows[i];
+  fwrite(&h, sizeof h, 1, _file);
+  _last_us = dwm_stats_now_us();
+  _recording = 1;
+  return 1;
+}
+
+void dwm_trace_stop_recording() {
+  if (!_recording)
+    return;
+  _write_atom_names();
+  fclose(_file);
+  _file = NULL;
+  _recording = 0;
+  free(_seen_atoms);
+  _seen_atoms = NULL;
+  _nseen_atoms = 0;
+}
+
+void dwm_trace_record(const XEvent* ev) {
+  if (!_recording)
+    return;
+  /* _note_atom() hands every atom back unchanged, ev is only read */
+  _for_each_atom((XEvent*)ev, _note_atom);
+  _write_record(_RecordEvent, _event_size(ev->type));
+  fwrite(ev, _event_size(ev->type), 1, _file);
+}
+
+void dwm_trace_record_batch_end() {
+  if (_recording)
+    _write_record(_RecordBatchEnd, 0);
+}
+
+static Atom _translate_atom(Atom atom) {
+  if (atom == None || atom <= XA_LAST_PREDEFINED)
+    return atom;
+  for (int i = 0; i < _natoms; ++i)
+    if (_atoms[i].from == atom)
+      return _atoms[i].to;
+  return None; /* never named in the trace, can't be one dwm knows */
+}
+
+static Window _translate_window(Window w, int create) {
+  if (w == None)
+    return None;
+  for (int i = 0; i < _nwindows; ++i)
+    if (_windows[i].from == w)
+      return _windows[i].to;
+  if (!create)
+    return None;
+  _windows = _grow(_windows, _nwindows, sizeof(_mapping_t));
+  _windows[_nwindows].from = w;
+  _windows[_nwindows].to
+    = XCreateSimpleWindow(dwm_x_display, dwm_x_window, 0, 0, 100, 100, 0, 0, 0);
+  _windows[_nwindows].standin = 1;
+  return _windows[_nwindows++].to;
+}
+
+/* the recorded window is gone, its id may be reused later in the trace */
+static void _forget_window(Window w) {
+  for (int i = 0; i < _nwindows; ++i)
+    if (_windows[i].from == w && _windows[i].standin) {
+      _doomed = _grow(_doomed, _ndoomed, sizeof(Window));
+      _doomed[_ndoomed++] = _windows[i].to;
+      _windows[i] = _windows[--_nwindows];
+      return;
+    }
+}
+
+static void _destroy_doomed() {
+  for (int i = 0; i < _ndoomed; ++i)
+    XDestroyWindow(dwm_x_display, _doomed[i]);
+  _ndoomed = 0;
+}
+
+static void _read_atom(size_t size) {
+  uint64_t a;
+  char name[size];
+
+  if (size <= sizeof a || fread(&a, sizeof a, 1, _file) != 1
+      || fread(name, size - sizeof a, 1, _file) != 1)
+    die("dwm: corrupt trace");
+  name[size - sizeof a] = '\0';
+  if (_translate_atom(a) != None)
+    return;
+  _atoms = _grow(_atoms, _natoms, sizeof(_mapping_t));
+  _atoms[_natoms].from = a;
+  _atoms[_natoms++].to = XInternAtom(dwm_x_display, name, False);
+}
+
+/* the names follow the events, they are needed before the first one */
+static void _read_atom_names() {
+  _record_t r;
+
+  while (fread(&r, sizeof r, 1, _file) == 1) {
+    if (r.kind == _RecordAtom)
+      _read_atom(r.size);
+    else if (fseek(_file, r.size, SEEK_CUR))
+      die("dwm: corrupt trace");
+  }
+}
+
+int dwm_trace_open(const char* path, const Window* windows, int n) {
+  _header_t h;
+
+  if (!(_file = fopen(path, "rb")))
+    return 0;
+  if (fread(&h, sizeof h, 1, _file) != 1 || memcmp(h.magic, _magic, sizeof _magic)
+      || h.version != _VERSION || h.nwindows > DWM_TRACE_MAX_WINDOWS) {
+    fclose(_file);
+    _file = NULL;
+    return 0;
+  }
+  for (int i = 0; i < MIN(n, (int)h.nwindows); ++i) {
+    if (!h.windows[i] || !windows[i])
+      continue;
+    _windows = _grow(_windows, _nwindows, sizeof(_mapping_t));
+    _windows[_nwindows].from = h.windows[i];
+    _windows[_nwindows].to = windows[i];
+    _windows[_nwindows++].standin = 0;
+  }
+  _first_record = ftell(_file);
+  _read_atom_names();
+  fseek(_file, _first_record, SEEK_SET);
+  return 1;
+}
+
+void dwm_trace_close() {
+  _destroy_doomed();
+  fclose(_file);
+  _file = NULL;
+  free(_windows);
+  free(_atoms);
+  free(_doomed);
+  _windows = _atoms = NULL;
+  _doomed = NULL;
+  _nwindows = _natoms = _ndoomed = 0;
+}
+
+void dwm_trace_rewind() {
+  _destroy_doomed();
+  fseek(_file, _first_record, SEEK_SET);
+  _eof = _done = _in_batch = 0;
+}
+
+int dwm_trace_next(XEvent* ev) {
+  _record_t r;
+  Window recorded;
+
+  if (!_in_batch) {
+    /* the previous batch is dispatched, nothing refers to these anymore */
+    _destroy_doomed();
+    _in_batch = 1;
+  }
+  while (!_eof) {
+    if (fread(&r, sizeof r, 1, _file) != 1) {
+      _eof = 1;
+      break;
+    }
+    if (r.kind == _RecordBatchEnd) {
+      _in_batch = 0;
+      return 0;
+    }
+    if (r.kind == _RecordAtom) {
+      fseek(_file, r.size, SEEK_CUR); /* read by dwm_trace_open() */
+      continue;
+    }
+    if (r.kind != _RecordEvent || r.size > sizeof(XEvent))
+      die("dwm: corrupt trace");
+    memset(ev, 0, sizeof(XEvent));
+    if (fread(ev, r.size, 1, _file) != 1)
+      die("dwm: corrupt trace");
+    ev->xany.display = dwm_x_display;
+    recorded = ev->type == DestroyNotify ? ev->xdestroywindow.window : None;
+    _for_each_atom(ev, _translate_atom);
+    _for_each_window(ev, _translate_window);
+    if (ev->type == DestroyNotify)
+      _forget_window(recorded);
+    return 1;
+  }
+  /* stand-ins still alive at the end are destroyed as if by their clients */
+  for (int i = 0; i < _nwindows; ++i)
+    if (_windows[i].standin) {
+      memset(ev, 0, sizeof(XEvent));
+      ev->type = DestroyNotify;
+      ev->xdestroywindow.display = dwm_x_display;
+      ev->xdestroywindow.event = dwm_x_window;
+      ev->xdestroywindow.window = _windows[i].to;
+      _forget_window(_windows[i].from);
+      return 1;
+    }
+  _done = 1;
+  _in_batch = 0;
+  return 0;
+}
+
+int dwm_trace_done() { return _done; }
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <X11/Xlib.h>
+
+// Binary trace of the X events dwm receives, for replaying a recorded
+// workload as a benchmark. The file starts with the well-known windows of the
+// recording session (root, systray, bars), followed by records of
+// {delta_us, kind, size} with the event truncated to the size of its type and
+// a marker after every batch, then the names of all non-predefined atoms the
+// events refer to. Records are in host byte order and XEvent layout.
+
+// windows the replaying session maps the recorded well-known windows onto
+#define DWM_TRACE_MAX_WINDOWS 34
+
+// Starts writing all events passed to dwm_trace_record() to path.
+int dwm_trace_start_recording(const char* path, const Window* windows, int n);
+
+void dwm_trace_stop_recording();
+
+// No-ops unless recording.
+void dwm_trace_record(const XEvent* ev);
+
+void dwm_trace_record_batch_end();
+
+// Opens a trace for replaying; windows are the well-known windows of this
+// session in the order they were recorded.
+int dwm_trace_open(const char* path, const Window* windows, int n);
+
+void dwm_trace_close();
+
+// Starts over from the first record.
+void dwm_trace_rewind();
+
+// Event source for dwm_fill_event_batch(). Returns the next event with its
+// windows and atoms translated to this session, 0 at the end of a recorded
+// batch. Windows first seen in the trace are backed by stand-in windows which
+// receive a synthetic DestroyNotify at the end of the trace.
+int dwm_trace_next(XEvent* ev);
+
+// True once dwm_trace_next() has returned every event of the trace.
+int dwm_trace_done();
@@ -0,0 +1,105 @@
+#include "dwm_winmap.h"
+
+#include "util.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define _MIN_BITS 6
+
+typedef struct {
+  Window win; /* None marks a free slot */
+  dwm_win_t data;
+} _slot_t;
+
+static _slot_t* _slots;
+static unsigned int _bits;
+static unsigned int _count;
+
+/* Fibonacci hashing, window ids of one client are consecutive */
+static unsigned int _hash(Window w) {
+  return (unsigned int)(((uint64_t)w * 0x9E3779B97F4A7C15ULL) >> (64 - _bits));
+}
+
+static unsigned int _mask() { return (1U << _bits) - 1; }
+
+static void _put(Window w, const dwm_win_t* data) {
+  unsigned int i = _hash(w);
+
+  while (_slots[i].win != None && _slots[i].win != w)
+    i = (i + 1) & _mask();
+  if (_slots[i].win == None)
+    ++_count;
+  _slots[i].win = w;
+  _slots[i].data = *data;
+}
+
+static void _resize(unsigned int bits) {
+  _slot_t* old = _slots;
+  unsigned int n = _slots ? 1U << _bits : 0;
+
+  _slots = ecalloc(1U << bits, sizeof(_slot_t));
+  _bits = bits;
+  _count = 0;
+  for (unsigned int i = 0; i < n; ++i)
+    if (old[i].win != None)
+      _put(old[i].win, &old[i].data);
+  free(old);
+}
+
+int dwm_winmap_insert(Window w, int kind, dwm_client_t* c, dwm_monitor_t* m) {
+  dwm_win_t data = {kind, c, m};
+  int known = dwm_winmap_find(w).kind;
+
+  if (known != DwmWinNone && known != kind)
+    return 0;
+  if (!_slots)
+    _resize(_MIN_BITS);
+  else if ((_count + 1) * 2 > 1U << _bits) /* load factor at most 1/2 */
+    _resize(_bits + 1);
+  _put(w, &data);
+  return 1;
+}
+
+void dwm_winmap_remove(Window w) {
+  unsigned int i, j, k;
+
+  if (!_slots || w == None)
+    return;
+  for (i = _hash(w); _slots[i].win != w; i = (i + 1) & _mask())
+    if (_slots[i].win == None)
+      return;
+  /* move back entries which would become unreachable through the hole at i */
+  for (j = (i + 1) & _mask(); _slots[j].win != None; j = (j + 1) & _mask()) {
+    k = _hash(_slots[j].win);
+    if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+      continue;
+    _slots[i] = _slots[j];
+    i = j;
+  }
+  _slots[i].win = None;
+  --_count;
+}
+
+dwm_win_t dwm_winmap_find(Window w) {
+  dwm_win_t none = {DwmWinNone, NULL, NULL};
+
+  if (!_slots || w == None)
+    return none;
+  for (unsigned int i = _hash(w); _slots[i].win != None; i = (i + 1) & _mask())
+    if (_slots[i].win == w)
+      return _slots[i].data;
+  return none;
+}
+
+dwm_client_t* dwm_winmap_find_client(Window w, int kind) {
+  dwm_win_t found = dwm_winmap_find(w);
+
+  return found.kind == kind ? found.client : NULL;
+}
+
+void dwm_winmap_release() {
+  free(_slots);
+  _slots = NULL;
+  _bits = _count = 0;
+}
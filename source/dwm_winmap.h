@@ -0,0 +1,40 @@
+#pragma once
+
+#include "dwm_global.h"
+
+#include <X11/Xlib.h>
+
+// Registry of all windows dwm knows about, so that a handler classifies the
+// window of an event with a single lookup instead of walking client lists,
+// systray icons and bars. Open addressing with linear probing; removal shifts
+// the following entries back, there are no tombstones.
+
+enum {
+  DwmWinNone,
+  DwmWinClient,
+  DwmWinTrayIcon,
+  DwmWinBar,
+  DwmWinTray,
+  DwmWinCheck,
+  DwmWinContainer
+};
+
+typedef struct {
+  int kind;
+  dwm_client_t* client; /* DwmWinClient, DwmWinTrayIcon */
+  dwm_monitor_t* mon; /* DwmWinBar, DwmWinContainer */
+} dwm_win_t;
+
+// Adds or updates the record of w. Returns 0 and keeps the record if w is
+// already known as another kind; callers check with dwm_winmap_find() first.
+int dwm_winmap_insert(Window w, int kind, dwm_client_t* c, dwm_monitor_t* m);
+
+void dwm_winmap_remove(Window w);
+
+// kind is DwmWinNone if dwm doesn't know w
+dwm_win_t dwm_winmap_find(Window w);
+
+// the client or tray icon of w if it is of kind, NULL otherwise
+dwm_client_t* dwm_winmap_find_client(Window w, int kind);
+
+void dwm_winmap_release();
@@ -0,0 +1,202 @@
+#include "dwm_xcb.h"
+
+#include "dwm_global.h"
+#include "dwm_stats.h"
+#include "util.h"
+
+#include <X11/Xatom.h>
+#include <X11/Xlib-xcb.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/* long_length is counted in 32 bit units */
+#define _TEXT_LENGTH (1 << 14)
+#define _NUM_SIZE_HINTS_ELEMENTS 18 /* ICCCM 4.1.2.3, 15 before X11R4 */
+#define _NUM_WM_HINTS_ELEMENTS 9 /* ICCCM 4.1.2.4, 8 before X11R4 */
+
+static const void* _value(const dwm_window_props_t* props,
+                          int prop,
+                          int format,
+                          unsigned int min_items) {
+  const xcb_get_property_reply_t* r = props->replies[prop];
+
+  if (!r || r->type == XCB_NONE || r->format != format || r->value_len < min_items)
+    return NULL;
+  return xcb_get_property_value(r);
+}
+
+void dwm_request_window_props(Window w, dwm_window_props_t* props) {
+  xcb_connection_t* conn = XGetXCBConnection(dwm_x_display);
+
+  const struct {
+    Atom property, type;
+    uint32_t length;
+  } requests[_DwmPropLast] = {
+    [DwmPropPid] = {dwm_x_net_atoms[NetWMPid], XA_CARDINAL, 1},
+    [DwmPropNetWMName] = {dwm_x_net_atoms[NetWMName], AnyPropertyType, _TEXT_LENGTH},
+    [DwmPropWMName] = {XA_WM_NAME, AnyPropertyType, _TEXT_LENGTH},
+    [DwmPropTransientFor] = {XA_WM_TRANSIENT_FOR, XA_WINDOW, 1},
+    [DwmPropClass] = {XA_WM_CLASS, XA_STRING, _TEXT_LENGTH},
+    [DwmPropNetWMState] = {dwm_x_net_atoms[NetWMState], XA_ATOM, 1},
+    [DwmPropNetWMWindowType] = {dwm_x_net_atoms[NetWMWindowType], XA_ATOM, 1},
+    [DwmPropNormalHints]
+    = {XA_WM_NORMAL_HINTS, XA_WM_SIZE_HINTS, _NUM_SIZE_HINTS_ELEMENTS},
+    [DwmPropHints] = {XA_WM_HINTS, XA_WM_HINTS, _NUM_WM_HINTS_ELEMENTS},
+    [DwmPropProtocols] = {dwm_x_wm_atoms[WMProtocols], XA_ATOM, 64},
+  };
+
+  /* Xlib may still buffer requests, they have to go out before ours */
+  XFlush(dwm_x_display);
+  for (int i = 0; i < _DwmPropLast; ++i) {
+    props->replies[i] = NULL;
+    props->cookies[i] = xcb_get_property(
+      conn, 0, w, requests[i].property, requests[i].type, 0, requests[i].length);
+  }
+}
+
+void dwm_collect_window_props(dwm_window_props_t* props) {
+  xcb_connection_t* conn = XGetXCBConnection(dwm_x_display);
+  xcb_generic_error_t* err;
+
+  for (int i = 0; i < _DwmPropLast; ++i) {
+    err = NULL;
+    props->replies[i] = xcb_get_property_reply(conn, props->cookies[i], &err);
+    free(err);
+  }
+  dwm_stats_note_round_trip();
+}
+
+void dwm_release_window_props(dwm_window_props_t* props) {
+  for (int i = 0; i < _DwmPropLast; ++i) {
+    free(props->replies[i]);
+    props->replies[i] = NULL;
+  }
+}
+
+int dwm_window_props_text(const dwm_window_props_t* props,
+                          int prop,
+                          XTextProperty* text) {
+  const xcb_get_property_reply_t* r = props->replies[prop];
+
+  if (!r || r->type == XCB_NONE || r->format != 8 || !r->value_len)
+    return 0;
+  text->value = xcb_get_property_value(r);
+  text->encoding = r->type;
+  text->format = r->format;
+  text->nitems = r->value_len;
+  return 1;
+}
+
+Window dwm_window_props_window(const dwm_window_props_t* props, int prop) {
+  const uint32_t* v = _value(props, prop, 32, 1);
+
+  return v ? v[0] : None;
+}
+
+unsigned long dwm_window_props_cardinal(const dwm_window_props_t* props, int prop) {
+  const uint32_t* v = _value(props, prop, 32, 1);
+
+  return v ? v[0] : 0;
+}
+
+Atom dwm_window_props_atom(const dwm_window_props_t* props, int prop) {
+  const uint32_t* v = _value(props, prop, 32, 1);
+
+  return v ? v[0] : None;
+}
+
+unsigned int dwm_window_props_length(const dwm_window_props_t* props, int prop) {
+  const xcb_get_property_reply_t* r = props->replies[prop];
+
+  return r && r->type != XCB_NONE ? r->value_len : 0;
+}
+
+int dwm_window_props_has_atom(const dwm_window_props_t* props, int prop, Atom atom) {
+  const uint32_t* v = _value(props, prop, 32, 1);
+
+  for (unsigned int i = 0; v && i < props->replies[prop]->value_len; ++i)
+    if (v[i] == atom)
+      return 1;
+  return 0;
+}
+
+int dwm_window_props_class(const dwm_window_props_t* props,
+                           char* instance,
+                           char* class,
+                           unsigned int size) {
+  const char* v = _value(props, DwmPropClass, 8, 1);
+  unsigned int len, n;
+
+  instance[0] = class[0] = '\0';
+  if (!v || !size)
+    return 0;
+  /* "instance\0class\0", the trailing NUL is optional */
+  len = props->replies[DwmPropClass]->value_len;
+  n = strnlen(v, len);
+  memcpy(instance, v, MIN(n, size - 1));
+  instance[MIN(n, size - 1)] = '\0';
+  if (n + 1 < len) {
+    v += n + 1;
+    len -= n + 1;
+    n = strnlen(v, len);
+    memcpy(class, v, MIN(n, size - 1));
+    class[MIN(n, size - 1)] = '\0';
+  }
+  return 1;
+}
+
+int dwm_window_props_size_hints(const dwm_window_props_t* props, XSizeHints* size) {
+  const uint32_t* v
+    = _value(props, DwmPropNormalHints, 32, _NUM_SIZE_HINTS_ELEMENTS - 3);
+
+  if (!v)
+    return 0;
+  size->flags = v[0];
+  size->x = (int32_t)v[1];
+  size->y = (int32_t)v[2];
+  size->width = (int32_t)v[3];
+  size->height = (int32_t)v[4];
+  size->min_width = (int32_t)v[5];
+  size->min_height = (int32_t)v[6];
+  size->max_width = (int32_t)v[7];
+  size->max_height = (int32_t)v[8];
+  size->width_inc = (int32_t)v[9];
+  size->height_inc = (int32_t)v[10];
+  size->min_aspect.x = (int32_t)v[11];
+  size->min_aspect.y = (int32_t)v[12];
+  size->max_aspect.x = (int32_t)v[13];
+  size->max_aspect.y = (int32_t)v[14];
+  if (props->replies[DwmPropNormalHints]->value_len < _NUM_SIZE_HINTS_ELEMENTS) {
+    /* pre-ICCCM hints, same as XGetWMNormalHints() */
+    size->flags &= ~(PBaseSize | PWinGravity);
+    size->base_width = size->base_height = 0;
+    size->win_gravity = NorthWestGravity;
+  } else {
+    size->base_width = (int32_t)v[15];
+    size->base_height = (int32_t)v[16];
+    size->win_gravity = (int32_t)v[17];
+  }
+  return 1;
+}
+
+int dwm_window_props_wm_hints(const dwm_window_props_t* props, XWMHints* wmh) {
+  const uint32_t* v = _value(props, DwmPropHints, 32, _NUM_WM_HINTS_ELEMENTS - 1);
+
+  if (!v)
+    return 0;
+  wmh->flags = v[0];
+  wmh->input = v[1] ? True : False;
+  wmh->initial_state = (int32_t)v[2];
+  wmh->icon_pixmap = v[3];
+  wmh->icon_window = v[4];
+  wmh->icon_x = (int32_t)v[5];
+  wmh->icon_y = (int32_t)v[6];
+  wmh->icon_mask = v[7];
+  if (props->replies[DwmPropHints]->value_len < _NUM_WM_HINTS_ELEMENTS) {
+    wmh->flags &= ~WindowGroupHint;
+    wmh->window_group = None;
+  } else
+    wmh->window_group = v[8];
+  return 1;
+}
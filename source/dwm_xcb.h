@@ -0,0 +1,61 @@
+#pragma once
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <xcb/xcb.h>
+
+// Properties manage() needs, fetched over the XCB connection underlying
+// dwm_x_display: all requests are issued at once and the replies collected
+// afterwards, so a new window costs one round trip of latency.
+enum {
+  DwmPropPid,
+  DwmPropNetWMName,
+  DwmPropWMName,
+  DwmPropTransientFor,
+  DwmPropClass,
+  DwmPropNetWMState,
+  DwmPropNetWMWindowType,
+  DwmPropNormalHints,
+  DwmPropHints,
+  DwmPropProtocols,
+  _DwmPropLast
+};
+
+typedef struct {
+  xcb_get_property_cookie_t cookies[_DwmPropLast];
+  xcb_get_property_reply_t* replies[_DwmPropLast];
+} dwm_window_props_t;
+
+void dwm_request_window_props(Window w, dwm_window_props_t* props);
+
+// Waits for all replies; missing properties and errors leave a NULL reply.
+void dwm_collect_window_props(dwm_window_props_t* props);
+
+void dwm_release_window_props(dwm_window_props_t* props);
+
+// The accessors below return 0 (None) if the property is absent or malformed.
+
+// text points into the reply and stays valid until release
+int dwm_window_props_text(const dwm_window_props_t* props, int prop, XTextProperty* text);
+
+Window dwm_window_props_window(const dwm_window_props_t* props, int prop);
+
+unsigned long dwm_window_props_cardinal(const dwm_window_props_t* props, int prop);
+
+// first atom of the property, like dwm_get_x_atom_property()
+Atom dwm_window_props_atom(const dwm_window_props_t* props, int prop);
+
+// number of items of the property, 0 if it is absent
+unsigned int dwm_window_props_length(const dwm_window_props_t* props, int prop);
+
+int dwm_window_props_has_atom(const dwm_window_props_t* props, int prop, Atom atom);
+
+// copies WM_CLASS into NUL terminated instance and class buffers of size bytes
+int dwm_window_props_class(const dwm_window_props_t* props,
+                           char* instance,
+                           char* class,
+                           unsigned int size);
+
+int dwm_window_props_size_hints(const dwm_window_props_t* props, XSizeHints* size);
+
+int dwm_window_props_wm_hints(const dwm_window_props_t* props, XWMHints* wmh);
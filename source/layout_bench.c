@@ -0,0 +1,71 @@
+/* Microbenchmark of the layout kernels for `make bench_layout`.
+ *
+ * Every kernel arranges 1, 10, 100 and 1000 clients with size hints honoured,
+ * as dwm does for tiled clients, and prints one line per count:
+ *
+ *   layout <name> n <N> ns_per_arrange <ns> ns_per_client <ns>
+ *
+ * Only the kernels are measured; committing the targets sends requests for
+ * clients whose geometry changed, which is nothing in steady state.
+ */
+
+#include "dwm_layout.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CLIENTS_PER_RUN 2000000UL
+
+static const struct {
+  const char* name;
+  dwm_layout_kernel_t kernel;
+} kernels[] = {
+  {"tile", dwm_layout_tile},
+  {"monocle", dwm_layout_monocle},
+  {"grid", dwm_layout_grid},
+  {"bstack", dwm_layout_bstack},
+  {"centeredmaster", dwm_layout_centeredmaster},
+  {"spiral", dwm_layout_spiral},
+  {"dwindle", dwm_layout_dwindle},
+};
+
+static const unsigned int counts[] = {1, 10, 100, 1000};
+
+static unsigned long now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(void) {
+  /* a terminal: base size plus character cells */
+  dwm_size_hints_t hints = {0, 0, 4, 4, 7, 15, 0, 0, 4, 4};
+  dwm_layout_client_t clients[1000];
+  dwm_rect_t out[1000];
+  unsigned long start, runs, sum = 0;
+
+  for (int i = 0; i < 1000; i++) {
+    clients[i].bw = 1;
+    clients[i].hints = &hints;
+  }
+  for (size_t k = 0; k < sizeof kernels / sizeof kernels[0]; k++)
+    for (size_t j = 0; j < sizeof counts / sizeof counts[0]; j++) {
+      dwm_layout_input_t in = {counts[j], clients, 0.55, 1, {0, 18, 1920, 1062}, 18};
+      runs = CLIENTS_PER_RUN / counts[j];
+      start = now_ns();
+      for (unsigned long r = 0; r < runs; r++) {
+        kernels[k].kernel(&in, out);
+        sum += out[counts[j] - 1].x;
+      }
+      start = now_ns() - start;
+      printf("layout %s n %u ns_per_arrange %lu ns_per_client %lu\n",
+             kernels[k].name,
+             counts[j],
+             start / runs,
+             start / (runs * counts[j]));
+    }
+  /* keeps the kernels from being optimized away */
+  return sum == 42;
+}